@@ -0,0 +1,22 @@
+#include "arc.h"
+#include <algorithm>
+
+float arcDeviation(float r, float start, float end) {
+    auto step = 1. / r;
+    long i = 0;
+    float maxError = 0;
+
+    forEachArcSegment(
+        [&](glm::vec2, glm::vec2 p2) {
+            auto angle = start + step * ++i;
+            auto expected =
+                glm::vec2{std::sin(angle) * r, std::cos(angle) * r};
+            maxError = std::max(maxError, glm::distance(p2, expected));
+        },
+        {},
+        r,
+        start,
+        end);
+
+    return maxError;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cmath>
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+
+// Call f(p1, p2) for each line segment of an arc around center, going from
+// start to end in steps of 1 / r radians. p2 of one segment is p1 of the next
+//
+// Instead of calling sin and cos for every point the points are generated by
+// rotating the previous point with a fixed rotation, in double precision so
+// that the error does not build up. See arcDeviation()
+template <typename F>
+void forEachArcSegment(F f,
+                       glm::vec2 center,
+                       float r,
+                       float start = 0,
+                       float end = glm::pi<float>() * 2) {
+    auto step = 1. / r;
+    if (!(step > 0) || start > end) {
+        return;
+    }
+
+    auto numSegments = static_cast<long>((end - start) / step) + 1;
+
+    auto stepSin = std::sin(step);
+    auto stepCos = std::cos(step);
+    auto s = std::sin(static_cast<double>(start));
+    auto c = std::cos(static_cast<double>(start));
+
+    auto p1 = center + glm::vec2{s * r, c * r};
+    for (long i = 0; i < numSegments; ++i) {
+        auto nextS = s * stepCos + c * stepSin;
+        c = c * stepCos - s * stepSin;
+        s = nextS;
+
+        auto p2 = center + glm::vec2{s * r, c * r};
+        f(p1, p2);
+        p1 = p2;
+    }
+}
+
+// Largest distance between the points from forEachArcSegment and the same
+// points calculated with sin and cos directly. Used to check that the error
+// stays below arcTolerance * r
+float arcDeviation(float r,
+                   float start = 0,
+                   float end = glm::pi<float>() * 2);
+
+// Relative to the radius
+constexpr float arcTolerance = 1e-5f;
@@ -0,0 +1,391 @@
+// Microbenchmarks for profile generation, transforms, draw list building,
+// gear train kinematics and point queries
+//
+// Usage:
+//   involute-bench [--filter text] [--min-time seconds] [-o file.json]
+//
+// Results are written as json to stdout (or the file given with -o) so that
+// they can be compared between releases. Build and run everything with the
+// "bench" target
+
+#include "arc.h"
+#include "compactprofile.h"
+#include "distancefield.h"
+#include "drawlist.h"
+#include "gearmesh.h"
+#include "gearprofile.h"
+#include "geartrain.h"
+#include "interference.h"
+#include "profilegenerator.h"
+#include "profilekernel.h"
+#include "settingsio.h"
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using ClockT = std::chrono::steady_clock;
+
+// Written to so that the compiler can not remove the benchmarked code
+volatile float sink = 0;
+
+void keep(glm::vec2 p) {
+    sink = sink + p.x;
+}
+
+struct Result {
+    std::string name;
+    size_t iterations = 0;
+    double nsPerIteration = 0;
+    double itemsPerSecond = 0;
+};
+
+struct Bench {
+    std::string filter;
+    double minTime = .2;
+    std::vector<Result> results;
+
+    // f runs one iteration and returns the number of items (points, gears...)
+    // that was processed
+    void run(const std::string &name, std::function<size_t()> f) {
+        if (!filter.empty() && name.find(filter) == std::string::npos) {
+            return;
+        }
+
+        f(); // Warm up
+
+        size_t iterations = 0;
+        size_t items = 0;
+        auto start = ClockT::now();
+        auto duration = ClockT::duration{};
+        for (size_t batch = 1;; batch *= 2) {
+            for (size_t i = 0; i < batch; ++i) {
+                items += f();
+            }
+            iterations += batch;
+            duration = ClockT::now() - start;
+            if (std::chrono::duration<double>(duration).count() >= minTime) {
+                break;
+            }
+        }
+
+        auto seconds = std::chrono::duration<double>(duration).count();
+        auto result = Result{
+            name,
+            iterations,
+            seconds * 1e9 / iterations,
+            items / seconds,
+        };
+        std::cerr << result.name << ": " << result.nsPerIteration << " ns\n";
+        results.push_back(result);
+    }
+};
+
+void benchProfiles(Bench &bench) {
+    for (int numTeeth : {10, 50, 100, 500, 2000}) {
+        auto settings = makeGearSettings(numTeeth, 1, 20);
+        auto suffix = "/" + std::to_string(numTeeth);
+
+        bench.run("profile/GearProfile" + suffix, [settings] {
+            auto profile = GearProfile{settings};
+            keep(profile.points.back());
+            return profile.points.size();
+        });
+
+        auto buffer = std::vector<glm::vec2>(profileSize(settings));
+        bench.run("profile/generateProfile" + suffix, [&] {
+            auto size = generateProfile(settings, buffer.data(), buffer.size());
+            keep(buffer.back());
+            return size;
+        });
+
+        auto x = std::vector<float>(profileSize(settings));
+        auto y = x;
+        bench.run("profile/generateProfileSoA" + suffix, [&] {
+            auto size =
+                generateProfileSoA(settings, x.data(), y.data(), x.size());
+            keep({x.back(), y.back()});
+            return size;
+        });
+
+        bench.run("profile/CompactProfile" + suffix, [settings] {
+            auto profile = CompactProfile{settings};
+            keep(profile.halfTooth.back());
+            return profile.size();
+        });
+
+        bench.run("profile/adaptive" + suffix, [settings] {
+            auto sampling = ProfileSampling::adaptive(settings, .001f);
+            auto profile = CompactProfile{settings, sampling};
+            keep(profile.halfTooth.back());
+            return profile.size();
+        });
+    }
+}
+
+void benchTransforms(Bench &bench) {
+    for (int numTeeth : {10, 100, 2000}) {
+        auto settings = makeGearSettings(numTeeth, 1, 20);
+        auto suffix = "/" + std::to_string(numTeeth);
+
+        auto half = std::vector<glm::vec2>(halfToothSize());
+        generateHalfTooth(settings, half.data());
+
+        // The old GearProfile chain, starting from a half tooth
+        auto profile = GearProfile{settings};
+        bench.run("transform/mirror+repeat" + suffix, [&] {
+            profile.points = half;
+            profile.mirror();
+            profile.repeat(settings.numTeeth);
+            keep(profile.points.back());
+            return profile.points.size();
+        });
+
+        auto full = GearProfile{settings};
+        bench.run("transform/rotatePoints" + suffix, [&] {
+            full.rotatePoints(.001f);
+            keep(full.points.back());
+            return full.points.size();
+        });
+
+        auto x = std::vector<float>(profileSize(settings));
+        auto y = x;
+        generateProfileSoA(settings, x.data(), y.data(), x.size());
+        bench.run("transform/transformBatch" + suffix, [&] {
+            transformBatch(x.data(),
+                           y.data(),
+                           x.data(),
+                           y.data(),
+                           x.size(),
+                           .001f,
+                           {.1f, .1f});
+            keep({x.back(), y.back()});
+            return x.size();
+        });
+    }
+}
+
+void benchDraw(Bench &bench) {
+    for (int numTeeth : {10, 100, 2000}) {
+        auto settings = makeGearSettings(numTeeth, 1, 20);
+        auto suffix = "/" + std::to_string(numTeeth);
+
+        auto compact = CompactProfile{settings};
+        auto buffer = std::vector<glm::vec2>{};
+        float angle = 0;
+        bench.run("draw/transformLoop" + suffix, [&] {
+            transformLoop(compact, {10, 10}, angle += .001f, 10, buffer);
+            keep(buffer.back());
+            return buffer.size();
+        });
+
+        bench.run("draw/ReferenceCircles" + suffix, [&] {
+            auto circles = ReferenceCircles{settings};
+            keep(circles.pitch.back());
+            return circles.addendum.size() + circles.clearing.size() +
+                   circles.dedendum.size() + circles.base.size() +
+                   circles.pitch.size();
+        });
+
+        bench.run("draw/triangulateProfile" + suffix, [&] {
+            auto mesh = triangulateProfile(compact);
+            keep(mesh.vertices.back());
+            return mesh.indices.size() / 3;
+        });
+
+        auto mesh = triangulateProfile(compact);
+        auto vertices = std::vector<MeshVertex>{};
+        bench.run("draw/transformMesh" + suffix, [&] {
+            transformMesh(mesh, {10, 10}, angle += .001f, 10, {}, vertices);
+            keep(vertices.back().position);
+            return vertices.size();
+        });
+
+        auto circles = ReferenceCircles{settings};
+        bench.run("draw/transformCircles" + suffix, [&] {
+            size_t size = 0;
+            for (auto *circle : {&circles.addendum,
+                                 &circles.clearing,
+                                 &circles.dedendum,
+                                 &circles.base,
+                                 &circles.pitch}) {
+                transformPoints(*circle, {10, 10}, 10, buffer);
+                keep(buffer.back());
+                size += buffer.size();
+            }
+            return size;
+        });
+
+        bench.run("draw/arcSegments" + suffix, [&] {
+            size_t size = 0;
+            forEachArcSegment(
+                [&size](glm::vec2 p1, glm::vec2) {
+                    keep(p1);
+                    ++size;
+                },
+                {},
+                settings.pitchD / 2);
+            return size;
+        });
+    }
+}
+
+// Square grid of meshing gears
+GearTrain makeGridTrain(int side) {
+    auto settings = makeGearSettings(20, 1, 20);
+    auto train = GearTrain{};
+    for (int y = 0; y < side; ++y) {
+        for (int x = 0; x < side; ++x) {
+            train.add(settings,
+                      glm::vec2{x * settings.pitchD, y * settings.pitchD});
+        }
+    }
+    return train;
+}
+
+void benchTrain(Bench &bench) {
+    for (int side : {10, 32, 100}) {
+        auto suffix = "/" + std::to_string(side * side);
+
+        bench.run("train/connect+solve" + suffix, [side] {
+            auto train = makeGridTrain(side);
+            train.connect();
+            train.solve();
+            return train.size();
+        });
+
+        auto train = makeGridTrain(side);
+        train.connect();
+        train.solve();
+        auto angles = std::vector<float>{};
+        float angle = 0;
+        bench.run("train/update" + suffix, [&] {
+            train.update(angle += .001f, angles);
+            keep({angles.back(), 0});
+            return angles.size();
+        });
+    }
+}
+
+// Points spread around the pitch circle, in and out of the teeth
+std::vector<glm::vec2> makeQueryPoints(const GearSettings &settings) {
+    auto points = std::vector<glm::vec2>(4096);
+    for (size_t i = 0; i < points.size(); ++i) {
+        auto angle = i * 1e-3f;
+        auto r = settings.pitchD / 2.f + std::sin(i * .37f) * settings.module;
+        points[i] = glm::vec2{std::cos(angle), std::sin(angle)} * r;
+    }
+    return points;
+}
+
+void benchQueries(Bench &bench) {
+    for (int numTeeth : {20, 1000}) {
+        auto settings = GearSettings{numTeeth};
+        auto suffix = "/" + std::to_string(numTeeth);
+        auto points = makeQueryPoints(settings);
+
+        auto loop = std::vector<glm::vec2>(profileSize(settings));
+        generateProfile(settings, loop.data(), loop.size());
+
+        bench.run("query/ProfileDistanceField" + suffix, [settings] {
+            auto field = ProfileDistanceField{settings};
+            keep({field.outerRadius(), 0});
+            return size_t{1};
+        });
+
+        auto field = ProfileDistanceField{settings};
+        auto distances = std::vector<float>(points.size());
+        bench.run("query/distances" + suffix, [&] {
+            field.distances(points.data(), points.size(), distances.data());
+            keep({distances.back(), 0});
+            return points.size();
+        });
+
+        auto bvh = SegmentBvh{loop};
+        bench.run("query/SegmentBvh::contains" + suffix, [&] {
+            size_t count = 0;
+            for (auto p : points) {
+                count += bvh.contains(p);
+            }
+            keep({static_cast<float>(count), 0});
+            return points.size();
+        });
+    }
+}
+
+void writeJson(std::FILE *out, const std::vector<Result> &results) {
+    std::fprintf(out, "{\n  \"context\": {\n");
+    std::fprintf(out,
+                 "    \"kernel\": \"%s\",\n",
+                 profileKernelInstructionSet());
+    std::fprintf(out,
+                 "    \"threads\": %u\n  },\n",
+                 std::thread::hardware_concurrency());
+    std::fprintf(out, "  \"benchmarks\": [\n");
+    for (size_t i = 0; i < results.size(); ++i) {
+        auto &result = results.at(i);
+        std::fprintf(out,
+                     "    {\"name\": \"%s\", \"iterations\": %zu, "
+                     "\"ns_per_iteration\": %.3f, "
+                     "\"items_per_second\": %.1f}%s\n",
+                     result.name.c_str(),
+                     result.iterations,
+                     result.nsPerIteration,
+                     result.itemsPerSecond,
+                     i + 1 < results.size() ? "," : "");
+    }
+    std::fprintf(out, "  ]\n}\n");
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    auto bench = Bench{};
+    auto output = std::string{};
+
+    for (int i = 1; i < argc; ++i) {
+        auto arg = std::string{argv[i]};
+        if (arg == "--filter" && i + 1 < argc) {
+            bench.filter = argv[++i];
+        }
+        else if (arg == "--min-time" && i + 1 < argc) {
+            bench.minTime = std::atof(argv[++i]);
+        }
+        else if (arg == "-o" && i + 1 < argc) {
+            output = argv[++i];
+        }
+        else {
+            std::cerr << "usage: involute-bench [--filter text] "
+                         "[--min-time seconds] [-o file.json]\n";
+            return 1;
+        }
+    }
+
+    benchProfiles(bench);
+    benchTransforms(bench);
+    benchDraw(bench);
+    benchTrain(bench);
+    benchQueries(bench);
+
+    auto out = stdout;
+    if (!output.empty()) {
+        out = std::fopen(output.c_str(), "w");
+        if (!out) {
+            std::cerr << "could not open " << output << "\n";
+            return 1;
+        }
+    }
+
+    writeJson(out, bench.results);
+
+    if (out != stdout) {
+        std::fclose(out);
+    }
+
+    return 0;
+}
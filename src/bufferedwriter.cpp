@@ -0,0 +1,120 @@
+#include "bufferedwriter.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+namespace {
+
+// Enough for any number that is formatted
+constexpr size_t maxNumberSize = 64;
+
+} // namespace
+
+BufferedWriter::BufferedWriter(std::FILE *file, size_t bufferSize)
+    : _file{file}
+    , _buffer(std::max(bufferSize, maxNumberSize)) {}
+
+BufferedWriter::~BufferedWriter() {
+    flush();
+}
+
+BufferedWriter &BufferedWriter::operator<<(const char *text) {
+    write(text, std::strlen(text));
+    return *this;
+}
+
+BufferedWriter &BufferedWriter::operator<<(char c) {
+    *reserve(1) = c;
+    ++_size;
+    return *this;
+}
+
+BufferedWriter &BufferedWriter::operator<<(int value) {
+    auto out = reserve(maxNumberSize);
+    _size += std::snprintf(out, maxNumberSize, "%d", value);
+    return *this;
+}
+
+BufferedWriter &BufferedWriter::operator<<(size_t value) {
+    auto out = reserve(maxNumberSize);
+    _size += std::snprintf(out, maxNumberSize, "%zu", value);
+    return *this;
+}
+
+BufferedWriter &BufferedWriter::operator<<(float value) {
+    if (!std::isfinite(value)) {
+        value = 0;
+    }
+
+    // Coordinates are written millions of times, so format them as integers
+    // instead of going through snprintf, and leave out trailing zeros
+    auto scale = 1.0;
+    for (int i = 0; i < _precision; ++i) {
+        scale *= 10;
+    }
+    auto scaled = std::round(std::abs(static_cast<double>(value)) * scale);
+    if (_precision > 9 || scaled >= 1e18) {
+        auto out = reserve(maxNumberSize);
+        _size += std::snprintf(out, maxNumberSize, "%g", value);
+        return *this;
+    }
+
+    auto fixed = static_cast<uint64_t>(scaled);
+    char digits[maxNumberSize];
+    int size = 0;
+    int decimals = _precision;
+    while (decimals > 0 && fixed % 10 == 0) {
+        fixed /= 10;
+        --decimals;
+    }
+    for (int i = 0; i < decimals; ++i) {
+        digits[size++] = static_cast<char>('0' + fixed % 10);
+        fixed /= 10;
+    }
+    if (decimals > 0) {
+        digits[size++] = '.';
+    }
+    do {
+        digits[size++] = static_cast<char>('0' + fixed % 10);
+        fixed /= 10;
+    } while (fixed);
+    if (value < 0 && !(size == 1 && digits[0] == '0')) {
+        digits[size++] = '-';
+    }
+
+    auto out = reserve(size);
+    for (int i = 0; i < size; ++i) {
+        out[i] = digits[size - 1 - i];
+    }
+    _size += size;
+    return *this;
+}
+
+void BufferedWriter::write(const void *data, size_t size) {
+    auto bytes = static_cast<const char *>(data);
+    while (size) {
+        if (_size == _buffer.size()) {
+            flush();
+        }
+        auto amount = std::min(size, _buffer.size() - _size);
+        std::memcpy(_buffer.data() + _size, bytes, amount);
+        _size += amount;
+        bytes += amount;
+        size -= amount;
+    }
+}
+
+void BufferedWriter::flush() {
+    if (_size && std::fwrite(_buffer.data(), 1, _size, _file) != _size) {
+        _isGood = false;
+    }
+    _size = 0;
+}
+
+char *BufferedWriter::reserve(size_t size) {
+    if (_buffer.size() - _size < size) {
+        flush();
+    }
+    return _buffer.data() + _size;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdio>
+#include <vector>
+
+// Formats text and numbers straight into a fixed size buffer that is written
+// to the file when full, so output of any length uses the same memory
+class BufferedWriter {
+public:
+    static constexpr size_t defaultBufferSize = 1 << 16;
+
+    // The file is not closed by the writer
+    explicit BufferedWriter(std::FILE *file,
+                            size_t bufferSize = defaultBufferSize);
+    ~BufferedWriter();
+
+    BufferedWriter(const BufferedWriter &) = delete;
+    BufferedWriter &operator=(const BufferedWriter &) = delete;
+
+    BufferedWriter &operator<<(const char *text);
+    BufferedWriter &operator<<(char c);
+    BufferedWriter &operator<<(int value);
+    BufferedWriter &operator<<(size_t value);
+
+    // Fixed point with trailing zeros removed, see setPrecision()
+    BufferedWriter &operator<<(float value);
+
+    // Raw bytes, for binary formats
+    void write(const void *data, size_t size);
+
+    // Number of decimals for floats (default 4)
+    void setPrecision(int decimals) {
+        _precision = decimals;
+    }
+
+    void flush();
+
+    // False if any write to the file has failed
+    bool good() const {
+        return _isGood;
+    }
+
+private:
+    // Make room for at least size bytes
+    char *reserve(size_t size);
+
+    std::FILE *_file;
+    std::vector<char> _buffer;
+    size_t _size = 0;
+    int _precision = 4;
+    bool _isGood = true;
+};
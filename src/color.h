@@ -0,0 +1,11 @@
+#pragma once
+
+#include <cstdint>
+
+// 8 bit RGBA, same layout as SDL_Color
+struct Color {
+    uint8_t r = 0;
+    uint8_t g = 0;
+    uint8_t b = 0;
+    uint8_t a = 255;
+};
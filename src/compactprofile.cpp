@@ -0,0 +1,13 @@
+#include "compactprofile.h"
+
+CompactProfile::CompactProfile(GearSettings settings,
+                               ProfileSampling sampling)
+    : settings{settings}
+    , sampling{sampling} {
+    computeProfile();
+}
+
+void CompactProfile::computeProfile() {
+    halfTooth.resize(halfToothSize(sampling));
+    generateHalfTooth(settings, halfTooth.data(), sampling);
+}
@@ -0,0 +1,152 @@
+#pragma once
+
+#include "gearsettings.h"
+#include "profilegenerator.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+#include <iterator>
+#include <vector>
+
+// Gear profile that only stores one half tooth
+//
+// Iterating gives the same closed loop as GearProfile::points, but the points
+// are expanded on the fly so the memory used is independent of the number of
+// teeth. The rotation of each tooth is calculated from its index
+struct CompactProfile {
+    CompactProfile(GearSettings settings, ProfileSampling sampling = {});
+
+    // Recalculate the half tooth after changing the settings or the sampling
+    void computeProfile();
+
+    class const_iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = glm::vec2;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const glm::vec2 *;
+        using reference = glm::vec2;
+
+        const_iterator() = default;
+
+        glm::vec2 operator*() const {
+            if (_tooth == _profile->numTeeth()) {
+                // The point closing the loop
+                return _profile->local(0);
+            }
+            auto p = _profile->local(_index);
+            auto r = _profile->rotation(_tooth);
+            return {r.x * p.x - r.y * p.y, r.y * p.x + r.x * p.y};
+        }
+
+        const_iterator &operator++() {
+            if (++_index == _profile->toothSize()) {
+                _index = 0;
+                ++_tooth;
+            }
+            return *this;
+        }
+
+        const_iterator operator++(int) {
+            auto tmp = *this;
+            ++*this;
+            return tmp;
+        }
+
+        bool operator==(const const_iterator &other) const {
+            return _tooth == other._tooth && _index == other._index;
+        }
+
+        bool operator!=(const const_iterator &other) const {
+            return !(*this == other);
+        }
+
+    private:
+        const_iterator(const CompactProfile *profile,
+                       size_t tooth,
+                       size_t index)
+            : _profile{profile}
+            , _tooth{tooth}
+            , _index{index} {}
+
+        const CompactProfile *_profile = nullptr;
+        size_t _tooth = 0;
+        size_t _index = 0;
+
+        friend CompactProfile;
+    };
+
+    const_iterator begin() const {
+        return {this, 0, 0};
+    }
+
+    const_iterator end() const {
+        return {this, numTeeth(), 1};
+    }
+
+    // Number of points in the expanded loop, including the closing point
+    size_t size() const {
+        return numTeeth() * toothSize() + 1;
+    }
+
+    size_t numTeeth() const {
+        return std::max(settings.numTeeth, 0);
+    }
+
+    // Cosine and sine of the rotation of a tooth
+    glm::vec2 rotation(size_t tooth) const {
+        if (tooth == 0) {
+            return {1, 0};
+        }
+        auto angle = glm::pi<float>() * 2.f * tooth / settings.numTeeth;
+        return {std::cos(angle), std::sin(angle)};
+    }
+
+    // Number of points for one full tooth
+    size_t toothSize() const {
+        return halfTooth.size() * 2;
+    }
+
+    // Point i of the expanded loop
+    glm::vec2 operator[](size_t i) const {
+        auto tooth = i / toothSize();
+        if (tooth >= numTeeth()) {
+            return local(0);
+        }
+        auto p = local(i % toothSize());
+        auto r = rotation(tooth);
+        return {r.x * p.x - r.y * p.y, r.y * p.x + r.x * p.y};
+    }
+
+    // Point i of the first tooth, before rotation
+    glm::vec2 local(size_t i) const {
+        auto n = halfTooth.size();
+        if (i < n) {
+            auto p = halfTooth[i];
+            return {p.x, -p.y};
+        }
+        return halfTooth[2 * n - 1 - i];
+    }
+
+    // Call f(p) for every point in the loop. Faster than using the iterators
+    template <typename F>
+    void forEachPoint(F f) const {
+        auto n = toothSize();
+        for (size_t tooth = 0; tooth < numTeeth(); ++tooth) {
+            auto r = rotation(tooth);
+            for (size_t i = 0; i < n; ++i) {
+                auto p = local(i);
+                f(glm::vec2{r.x * p.x - r.y * p.y, r.y * p.x + r.x * p.y});
+            }
+        }
+        f(local(0));
+    }
+
+    GearSettings settings;
+    ProfileSampling sampling;
+
+    // The half tooth as returned by generateHalfTooth()
+    std::vector<glm::vec2> halfTooth;
+};
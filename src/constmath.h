@@ -0,0 +1,211 @@
+#pragma once
+
+#include <cmath>
+
+// Math functions that can be used in constant expressions
+//
+// At run time they call the standard functions, so results are exactly the
+// same as before. During constant evaluation they use series in double
+// precision instead, which can differ from the standard functions in the
+// last bit of the float result
+
+namespace constmath {
+
+constexpr double pi = 3.14159265358979323846;
+constexpr double ln2 = 0.69314718055994530942;
+
+constexpr double abs(double x) {
+    return x < 0 ? -x : x;
+}
+
+// Reduce to [-pi, pi]
+constexpr double wrapAngle(double x) {
+    auto turns = static_cast<long long>(x / (2 * pi));
+    x -= static_cast<double>(turns) * 2 * pi;
+    if (x > pi) {
+        x -= 2 * pi;
+    }
+    else if (x < -pi) {
+        x += 2 * pi;
+    }
+    return x;
+}
+
+// Taylor series, converges quickly for |x| <= pi
+constexpr double sinSeries(double x) {
+    x = wrapAngle(x);
+    auto term = x;
+    auto sum = x;
+    for (int i = 1; i < 20; ++i) {
+        term *= -x * x / ((2 * i) * (2 * i + 1));
+        sum += term;
+    }
+    return sum;
+}
+
+constexpr double sqrtNewton(double x) {
+    if (!(x > 0)) {
+        return 0;
+    }
+    // Start from a power of two close to the root
+    auto guess = 1.;
+    for (auto y = x; y > 4; y /= 4) {
+        guess *= 2;
+    }
+    for (auto y = x; y < .25; y *= 4) {
+        guess /= 2;
+    }
+    for (int i = 0; i < 8; ++i) {
+        guess = (guess + x / guess) / 2;
+    }
+    return guess;
+}
+
+constexpr double atanSeries(double x) {
+    // atan(x) = pi / 2 - atan(1 / x), then halve the argument twice with
+    // atan(x) = 2 atan(x / (1 + sqrt(1 + x^2))) so the series converges fast
+    auto negative = x < 0;
+    x = abs(x);
+    auto inverted = x > 1;
+    if (inverted) {
+        x = 1 / x;
+    }
+    for (int i = 0; i < 2; ++i) {
+        x = x / (1 + sqrtNewton(1 + x * x));
+    }
+    auto term = x;
+    auto sum = x;
+    for (int i = 1; i < 20; ++i) {
+        term *= -x * x;
+        sum += term / (2 * i + 1);
+    }
+    sum *= 4;
+    if (inverted) {
+        sum = pi / 2 - sum;
+    }
+    return negative ? -sum : sum;
+}
+
+constexpr double logSeries(double x) {
+    if (!(x > 0)) {
+        return 0;
+    }
+    // x = m * 2^e with m in [0.5, 1), then log(m) = 2 atanh((m - 1) / (m + 1))
+    auto e = 0;
+    for (; x >= 1; x /= 2) {
+        ++e;
+    }
+    for (; x < .5; x *= 2) {
+        --e;
+    }
+    auto y = (x - 1) / (x + 1);
+    auto term = y;
+    auto sum = y;
+    for (int i = 1; i < 30; ++i) {
+        term *= y * y;
+        sum += term / (2 * i + 1);
+    }
+    return 2 * sum + e * ln2;
+}
+
+constexpr double expSeries(double x) {
+    // x = k ln2 + r with |r| <= ln2 / 2, exp(x) = 2^k exp(r)
+    auto k = static_cast<long long>(x / ln2 + (x < 0 ? -.5 : .5));
+    auto r = x - k * ln2;
+    auto term = 1.;
+    auto sum = 1.;
+    for (int i = 1; i < 25; ++i) {
+        term *= r / i;
+        sum += term;
+    }
+    for (; k > 0; --k) {
+        sum *= 2;
+    }
+    for (; k < 0; ++k) {
+        sum /= 2;
+    }
+    return sum;
+}
+
+} // namespace constmath
+
+constexpr float constSin(float x) {
+    if (!__builtin_is_constant_evaluated()) {
+        return std::sin(x);
+    }
+    return static_cast<float>(constmath::sinSeries(x));
+}
+
+constexpr float constCos(float x) {
+    if (!__builtin_is_constant_evaluated()) {
+        return std::cos(x);
+    }
+    return static_cast<float>(constmath::sinSeries(x + constmath::pi / 2));
+}
+
+constexpr float constSqrt(float x) {
+    if (!__builtin_is_constant_evaluated()) {
+        return std::sqrt(x);
+    }
+    return static_cast<float>(constmath::sqrtNewton(x));
+}
+
+constexpr float constAtan2(float y, float x) {
+    if (!__builtin_is_constant_evaluated()) {
+        return std::atan2(y, x);
+    }
+    if (x > 0) {
+        return static_cast<float>(constmath::atanSeries(y / x));
+    }
+    if (x < 0) {
+        auto a = constmath::atanSeries(static_cast<double>(y) / x);
+        return static_cast<float>(y >= 0 ? a + constmath::pi
+                                         : a - constmath::pi);
+    }
+    if (y == 0) {
+        return 0;
+    }
+    return static_cast<float>(y > 0 ? constmath::pi / 2 : -constmath::pi / 2);
+}
+
+constexpr float constAbs(float x) {
+    if (!__builtin_is_constant_evaluated()) {
+        return std::abs(x);
+    }
+    return x < 0 ? -x : x;
+}
+
+constexpr float constCopysign(float x, float sign) {
+    if (!__builtin_is_constant_evaluated()) {
+        return std::copysign(x, sign);
+    }
+    return (sign < 0) == (x < 0) ? x : -x;
+}
+
+constexpr float constPow(float x, float y) {
+    if (!__builtin_is_constant_evaluated()) {
+        return std::pow(x, y);
+    }
+    if (x == 0) {
+        return y == 0 ? 1.f : 0.f;
+    }
+    // Only positive bases are needed
+    return static_cast<float>(
+        constmath::expSeries(y * constmath::logSeries(x)));
+}
+
+constexpr float constCbrt(float x) {
+    if (!__builtin_is_constant_evaluated()) {
+        return std::cbrt(x);
+    }
+    if (x == 0) {
+        return 0;
+    }
+    auto a = constmath::abs(x);
+    auto root = constmath::expSeries(constmath::logSeries(a) / 3);
+    // Polish with Newton's method
+    for (int i = 0; i < 2; ++i) {
+        root -= (root * root * root - a) / (3 * root * root);
+    }
+    return static_cast<float>(x < 0 ? -root : root);
+}
@@ -0,0 +1,311 @@
+#include "distancefield.h"
+#include "geartrain.h"
+#include "threadpool.h"
+#include <algorithm>
+#include <cmath>
+#include <glm/gtc/constants.hpp>
+#include <limits>
+
+namespace {
+
+float segmentDistance(glm::vec2 p, glm::vec2 a, glm::vec2 b) {
+    auto e = b - a;
+    auto length2 = glm::dot(e, e);
+    auto t = length2 > 0
+                 ? std::clamp(glm::dot(p - a, e) / length2, 0.f, 1.f)
+                 : 0.f;
+    return glm::length(p - (a + e * t));
+}
+
+glm::vec2 placed(glm::vec2 p, float c, float s, glm::vec2 pos) {
+    return glm::vec2{c * p.x - s * p.y, s * p.x + c * p.y} + pos;
+}
+
+std::vector<glm::vec2> generateLoop(const GearSettings &settings,
+                                    ProfileSampling sampling) {
+    auto loop = std::vector<glm::vec2>(profileSize(settings, sampling));
+    generateProfile(settings, loop.data(), loop.size(), sampling);
+    return loop;
+}
+
+// Smallest distance from the points of a generated loop to field, where
+// placement places the loop in the coordinates of the field. Only the teeth
+// that face the field are checked: a point inside its outer radius is at
+// most asin(outer radius / center distance) from the line between the
+// centers, seen from the center of the loop
+float loopDistance(const ProfileDistanceField &field,
+                   const std::vector<glm::vec2> &loop,
+                   const GearSettings &settings,
+                   size_t toothSize,
+                   Placement placement) {
+    auto distance = glm::length(placement.pos);
+    auto reach = field.outerRadius();
+    if (distance <= reach) {
+        return field.minDistance(loop.data(), loop.size(), placement);
+    }
+
+    auto direction =
+        std::atan2(-placement.pos.y, -placement.pos.x) - placement.angle;
+    auto halfAngle = std::asin(reach / distance);
+
+    // One extra tooth on each side, since the roots of large gears reach
+    // into the neighbouring pitch
+    auto pitch = settings.pitchAngle;
+    auto first =
+        static_cast<int>(std::floor((direction - halfAngle) / pitch)) - 1;
+    auto last =
+        static_cast<int>(std::ceil((direction + halfAngle) / pitch)) + 1;
+    if (last - first + 1 >= settings.numTeeth) {
+        return field.minDistance(loop.data(), loop.size(), placement);
+    }
+
+    auto result = std::numeric_limits<float>::infinity();
+    for (auto tooth = first; tooth <= last; ++tooth) {
+        auto index = (tooth % settings.numTeeth + settings.numTeeth) %
+                     settings.numTeeth;
+        result = std::min(
+            result,
+            field.minDistance(
+                loop.data() + index * toothSize, toothSize, placement));
+    }
+    return result;
+}
+
+} // namespace
+
+ProfileDistanceField::ProfileDistanceField(const std::vector<glm::vec2> &loop,
+                                           int numTeeth,
+                                           Resolution resolution)
+    : _numTeeth{std::max(1, numTeeth)}
+    , _pitchAngle{glm::pi<float>() * 2.f / _numTeeth}
+    , _resolution{resolution} {
+    _resolution.numAngles = std::max(2, _resolution.numAngles);
+    _resolution.numRadii = std::max(2, _resolution.numRadii);
+    build(loop);
+}
+
+ProfileDistanceField::ProfileDistanceField(const GearSettings &settings,
+                                           ProfileSampling sampling)
+    : ProfileDistanceField{settings, sampling, Resolution{}} {}
+
+ProfileDistanceField::ProfileDistanceField(const GearSettings &settings,
+                                           ProfileSampling sampling,
+                                           Resolution resolution)
+    : ProfileDistanceField{
+          generateLoop(settings, sampling), settings.numTeeth, resolution} {}
+
+void ProfileDistanceField::build(const std::vector<glm::vec2> &loop) {
+    auto numAngles = _resolution.numAngles;
+    auto numRadii = _resolution.numRadii;
+    _values.assign(static_cast<size_t>(numAngles) * numRadii, 0.f);
+    if (loop.size() < 2) {
+        return;
+    }
+
+    // The teeth reach from the root, where the loop last crosses the middle
+    // of the gap, to the largest radius. Points further in are not used: the
+    // roots of generated profiles with more than about 42 teeth fold back
+    // towards the base circle, many modules inside the root, which would
+    // stretch the grid cells over the whole range
+    auto gap = glm::vec2{std::cos(_pitchAngle / 2.f),
+                         std::sin(_pitchAngle / 2.f)};
+    auto rootRadius = 0.f;
+    auto minRadius = std::numeric_limits<float>::infinity();
+    auto maxRadius = 0.f;
+    for (size_t i = 0; i < loop.size(); ++i) {
+        auto r = glm::length(loop[i]);
+        minRadius = std::min(minRadius, r);
+        maxRadius = std::max(maxRadius, r);
+        if (i + 1 == loop.size()) {
+            break;
+        }
+        // Distances along and across the middle of the gap
+        auto a = glm::vec2{glm::dot(loop[i], gap),
+                           gap.x * loop[i].y - gap.y * loop[i].x};
+        auto b = glm::vec2{glm::dot(loop[i + 1], gap),
+                           gap.x * loop[i + 1].y - gap.y * loop[i + 1].x};
+        if ((a.y > 0) != (b.y > 0)) {
+            auto x = a.x + (b.x - a.x) * a.y / (a.y - b.y);
+            rootRadius = std::max(rootRadius, x);
+        }
+    }
+    minRadius = std::clamp(rootRadius, minRadius, maxRadius);
+    auto margin = (maxRadius - minRadius) * _resolution.margin;
+    _innerRadius = std::max(0.f, minRadius - margin);
+    _outerRadius = maxRadius + margin;
+
+    // The loop is symmetric around the lines through the center at angle 0
+    // and at one pitch, and the grid is between them, so segments entirely
+    // on the other side of either line always have a mirror image that is
+    // closer. That leaves about one half tooth on each side of the gap
+    auto side = glm::vec2{std::cos(_pitchAngle), std::sin(_pitchAngle)};
+    auto segments = std::vector<std::pair<glm::vec2, glm::vec2>>{};
+    for (size_t i = 0; i + 1 < loop.size(); ++i) {
+        auto a = loop[i];
+        auto b = loop[i + 1];
+        auto isBelow = a.y < 0 && b.y < 0;
+        auto isAbove = side.x * a.y - side.y * a.x > 0 &&
+                       side.x * b.y - side.y * b.x > 0;
+        if (_numTeeth <= 2 || !(isBelow || isAbove)) {
+            segments.push_back({a, b});
+        }
+    }
+
+    // Every column is turned so that its points are on the x axis. Points
+    // are inside if the ray outwards along the axis crosses the loop an odd
+    // number of times, which only the kept segments can do
+    auto turned = segments;
+    for (int column = 0; column < numAngles; ++column) {
+        auto angle = _pitchAngle / 2.f * column / (numAngles - 1);
+        auto c = std::cos(-angle);
+        auto s = std::sin(-angle);
+        for (size_t i = 0; i < segments.size(); ++i) {
+            turned[i] = {placed(segments[i].first, c, s, {0, 0}),
+                         placed(segments[i].second, c, s, {0, 0})};
+        }
+
+        for (int row = 0; row < numRadii; ++row) {
+            auto r = _innerRadius +
+                     (_outerRadius - _innerRadius) * row / (numRadii - 1);
+            auto p = glm::vec2{r, 0};
+            auto d = std::numeric_limits<float>::infinity();
+            auto isInside = false;
+            for (auto &[a, b] : turned) {
+                d = std::min(d, segmentDistance(p, a, b));
+                if ((a.y > 0) != (b.y > 0) &&
+                    a.x + (b.x - a.x) * a.y / (a.y - b.y) > r) {
+                    isInside = !isInside;
+                }
+            }
+            _values[static_cast<size_t>(row) * numAngles + column] =
+                isInside ? -d : d;
+        }
+    }
+}
+
+float ProfileDistanceField::distance(glm::vec2 p) const {
+    auto numAngles = _resolution.numAngles;
+    auto numRadii = _resolution.numRadii;
+
+    // Fold the angle onto the half tooth
+    auto angle = std::atan2(p.y, p.x);
+    angle = std::abs(angle - _pitchAngle * std::round(angle / _pitchAngle));
+    auto u = std::min(angle / (_pitchAngle / 2.f), 1.f) * (numAngles - 1);
+
+    auto r = glm::length(p);
+    auto clamped = std::clamp(r, _innerRadius, _outerRadius);
+    auto v = (clamped - _innerRadius) / (_outerRadius - _innerRadius) *
+             (numRadii - 1);
+
+    auto column = std::min(static_cast<int>(u), numAngles - 2);
+    auto row = std::min(static_cast<int>(v), numRadii - 2);
+    auto fu = u - column;
+    auto fv = v - row;
+
+    auto at = [this, numAngles](int row, int column) {
+        return _values[static_cast<size_t>(row) * numAngles + column];
+    };
+    auto inner = at(row, column) * (1 - fu) + at(row, column + 1) * fu;
+    auto outer = at(row + 1, column) * (1 - fu) + at(row + 1, column + 1) * fu;
+    return inner * (1 - fv) + outer * fv + (r - clamped);
+}
+
+void ProfileDistanceField::distances(const glm::vec2 *points,
+                                     size_t count,
+                                     float *out,
+                                     Placement placement) const {
+    auto c = std::cos(placement.angle);
+    auto s = std::sin(placement.angle);
+    for (size_t i = 0; i < count; ++i) {
+        out[i] = distance(placed(points[i], c, s, placement.pos));
+    }
+}
+
+float ProfileDistanceField::minDistance(const glm::vec2 *points,
+                                        size_t count,
+                                        Placement placement) const {
+    auto c = std::cos(placement.angle);
+    auto s = std::sin(placement.angle);
+    auto result = std::numeric_limits<float>::infinity();
+    for (size_t i = 0; i < count; ++i) {
+        result =
+            std::min(result, distance(placed(points[i], c, s, placement.pos)));
+    }
+    return result;
+}
+
+bool ProfileDistanceField::containsAny(const glm::vec2 *points,
+                                       size_t count,
+                                       Placement placement) const {
+    auto c = std::cos(placement.angle);
+    auto s = std::sin(placement.angle);
+    for (size_t i = 0; i < count; ++i) {
+        if (distance(placed(points[i], c, s, placement.pos)) < 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+Placement relativePlacement(Placement gear, Placement other) {
+    auto c = std::cos(-gear.angle);
+    auto s = std::sin(-gear.angle);
+    return {placed(other.pos - gear.pos, c, s, {0, 0}),
+            other.angle - gear.angle};
+}
+
+MeshSweep sweepMeshField(const GearSettings &a,
+                         const GearSettings &b,
+                         float centerDistance,
+                         int numSteps,
+                         ThreadPool &pool,
+                         ProfileSampling sampling) {
+    auto loopA = generateLoop(a, sampling);
+    auto loopB = generateLoop(b, sampling);
+    auto fieldA = ProfileDistanceField{loopA, a.numTeeth, {}};
+    auto fieldB = ProfileDistanceField{loopB, b.numTeeth, {}};
+    // The closing points are not needed for the queries
+    loopA.pop_back();
+    loopB.pop_back();
+    auto toothSize = 2 * halfToothSize(sampling);
+
+    auto sweep = MeshSweep{};
+    numSteps = std::max(numSteps, 1);
+    sweep.angles.resize(numSteps);
+    sweep.clearances.resize(numSteps);
+
+    pool.parallelFor(numSteps, [&](size_t i) {
+        auto angle = a.pitchAngle * static_cast<float>(i) / numSteps;
+        auto placementA = Placement{{0, 0}, angle};
+        auto placementB =
+            Placement{{centerDistance, 0}, meshingAngle(a, angle, b, 0)};
+
+        auto distance = std::min(
+            loopDistance(fieldA,
+                         loopB,
+                         b,
+                         toothSize,
+                         relativePlacement(placementA, placementB)),
+            loopDistance(fieldB,
+                         loopA,
+                         a,
+                         toothSize,
+                         relativePlacement(placementB, placementA)));
+
+        sweep.angles[i] = angle;
+        sweep.clearances[i] = {std::max(distance, 0.f), distance < 0};
+    });
+
+    for (size_t i = 0; i < sweep.clearances.size(); ++i) {
+        auto &c = sweep.clearances[i];
+        if (c.distance < sweep.minClearance) {
+            sweep.minClearance = c.distance;
+            sweep.minClearanceAngle = sweep.angles[i];
+        }
+        if (c.isColliding) {
+            sweep.collisionAngles.push_back(sweep.angles[i]);
+        }
+    }
+
+    return sweep;
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include "gearsettings.h"
+#include "interference.h"
+#include "profilegenerator.h"
+#include <cstddef>
+#include <glm/glm.hpp>
+#include <vector>
+
+class ThreadPool;
+
+// Signed distance to a gear profile, negative inside, sampled on a polar grid
+//
+// Every tooth is the same and symmetric around its center, so the grid only
+// covers half a tooth: angles from the center of tooth 0 to the middle of the
+// gap, and radii from a bit inside the root to a bit outside the tips. A
+// query folds the angle onto that half tooth and interpolates between the
+// four closest grid points, which takes the same time for any number of
+// teeth and points in the profile
+//
+// The root is where the loop crosses the middle of the gap, not the smallest
+// radius of the loop, since generated profiles with more than about 42 teeth
+// fold back towards the base circle below it. So the grid spans twice the
+// height of the teeth for any number of teeth, and with the default
+// resolution a cell is at most about 0.02 modules across. Against the exact
+// distance to the loop the values are off by less than 0.007 modules inside
+// the grid, for 8 to 1000 teeth, so the sign is right for every point further
+// than that from the outline
+//
+// Beyond the radii of the grid the value at its edge is continued along the
+// radius, which is only approximate, but those points are at least the
+// margin away from the teeth
+class ProfileDistanceField {
+public:
+    struct Resolution {
+        // Grid points over the half tooth
+        int numAngles = 128;
+        // Grid points from the inner to the outer radius
+        int numRadii = 256;
+        // How far the grid reaches inside the root and outside the tips,
+        // relative to the height of the teeth
+        float margin = .5f;
+    };
+
+    // loop is a closed profile with numTeeth teeth like GearProfile::points,
+    // with tooth 0 centered at angle 0 and mirrored around it, which is what
+    // generateProfile() and EnvelopeProfile::points() give
+    ProfileDistanceField(const std::vector<glm::vec2> &loop,
+                         int numTeeth,
+                         Resolution resolution);
+
+    explicit ProfileDistanceField(const GearSettings &settings,
+                                  ProfileSampling sampling = {});
+    ProfileDistanceField(const GearSettings &settings,
+                         ProfileSampling sampling,
+                         Resolution resolution);
+
+    // Signed distance from p, in the coordinates of the gear
+    float distance(glm::vec2 p) const;
+
+    bool contains(glm::vec2 p) const {
+        return distance(p) < 0;
+    }
+
+    // Batch versions. The points are in a frame that is placed with
+    // placement in the coordinates of the gear, so the points of another
+    // profile can be passed as they are, see relativePlacement()
+    void distances(const glm::vec2 *points,
+                   size_t count,
+                   float *out,
+                   Placement placement = {}) const;
+
+    // Smallest signed distance of the points, negative if any of them is
+    // inside
+    float minDistance(const glm::vec2 *points,
+                      size_t count,
+                      Placement placement = {}) const;
+
+    // Same as minDistance() < 0 but stops at the first point inside
+    bool containsAny(const glm::vec2 *points,
+                     size_t count,
+                     Placement placement = {}) const;
+
+    float innerRadius() const {
+        return _innerRadius;
+    }
+
+    float outerRadius() const {
+        return _outerRadius;
+    }
+
+private:
+    void build(const std::vector<glm::vec2> &loop);
+
+    int _numTeeth = 0;
+    float _pitchAngle = 0;
+    Resolution _resolution;
+    float _innerRadius = 0;
+    float _outerRadius = 0;
+
+    // numRadii rows of numAngles values
+    std::vector<float> _values;
+};
+
+// Placement of other in the coordinates of a gear placed with gear
+Placement relativePlacement(Placement gear, Placement other);
+
+// Same as sweepMesh() but with the clearance measured from the points of each
+// profile to the distance field of the other gear, instead of between the
+// segments. Only the points of the teeth that face the other gear are
+// looked up, so every step costs the same for any number of teeth. The
+// results are only as exact as the fields, and overlaps where no point of
+// either profile is inside the other, like two sharp tips crossing, are
+// missed
+MeshSweep sweepMeshField(const GearSettings &a,
+                         const GearSettings &b,
+                         float centerDistance,
+                         int numSteps,
+                         ThreadPool &pool,
+                         ProfileSampling sampling = {});
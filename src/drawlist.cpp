@@ -0,0 +1,204 @@
+#include "drawlist.h"
+#include "arc.h"
+#include <algorithm>
+#include <cmath>
+#include <glm/gtc/constants.hpp>
+
+void transformPoints(const std::vector<glm::vec2> &points,
+                     glm::vec2 pos,
+                     float scale,
+                     std::vector<glm::vec2> &out) {
+    out.resize(points.size());
+    for (size_t i = 0; i < points.size(); ++i) {
+        out[i] = (points[i] + pos) * scale;
+    }
+}
+
+void transformMesh(const GearMesh &mesh,
+                   glm::vec2 pos,
+                   float angle,
+                   float scale,
+                   Color color,
+                   std::vector<MeshVertex> &out) {
+    out.resize(mesh.vertices.size());
+    auto c = std::cos(angle) * scale;
+    auto s = std::sin(angle) * scale;
+    auto offset = pos * scale;
+    for (size_t i = 0; i < mesh.vertices.size(); ++i) {
+        auto p = mesh.vertices[i];
+        out[i] = {glm::vec2{c * p.x - s * p.y, s * p.x + c * p.y} + offset,
+                  color,
+                  {}};
+    }
+}
+
+ToothRange visibleTeeth(const CompactProfile &profile,
+                        glm::vec2 pos,
+                        float angle,
+                        glm::vec2 viewMin,
+                        glm::vec2 viewMax) {
+    auto numTeeth = profile.numTeeth();
+    auto all = ToothRange{0, numTeeth};
+
+    // Extent of a tooth, it is symmetric around the x axis
+    auto radius = 0.f;
+    auto extent = 0.f;
+    for (auto p : profile.halfTooth) {
+        radius = std::max(radius, glm::length(p));
+        extent = std::max(extent, std::abs(std::atan2(p.y, p.x)));
+    }
+
+    auto closest = glm::vec2{std::clamp(pos.x, viewMin.x, viewMax.x),
+                             std::clamp(pos.y, viewMin.y, viewMax.y)};
+    auto distance = glm::length(closest - pos);
+    if (distance > radius) {
+        return {};
+    }
+    if (distance <= 0) {
+        // The center is on screen
+        return all;
+    }
+
+    // The rectangle is on one side of the line through the center that is
+    // perpendicular to the direction of the closest point, so seen from that
+    // direction all corners are within a quarter turn
+    auto reference = std::atan2(closest.y - pos.y, closest.x - pos.x);
+    auto from = 0.f;
+    auto to = 0.f;
+    for (auto corner : {viewMin,
+                        glm::vec2{viewMax.x, viewMin.y},
+                        viewMax,
+                        glm::vec2{viewMin.x, viewMax.y}}) {
+        auto d = corner - pos;
+        auto a = std::atan2(d.y, d.x) - reference;
+        a = std::remainder(a, glm::pi<float>() * 2);
+        from = std::min(from, a);
+        to = std::max(to, a);
+    }
+
+    auto pitch = profile.settings.pitchAngle;
+    auto first = std::ceil((reference + from - angle - extent) / pitch) - 1;
+    auto last = std::floor((reference + to - angle + extent) / pitch) + 1;
+    auto count = last - first + 1;
+    if (count >= numTeeth) {
+        return all;
+    }
+    auto wrapped = std::fmod(first, static_cast<float>(numTeeth));
+    if (wrapped < 0) {
+        wrapped += numTeeth;
+    }
+    return {static_cast<size_t>(wrapped) % numTeeth,
+            static_cast<size_t>(count)};
+}
+
+void transformTeeth(const CompactProfile &profile,
+                    ToothRange range,
+                    glm::vec2 pos,
+                    float angle,
+                    float scale,
+                    std::vector<glm::vec2> &out) {
+    auto numTeeth = profile.numTeeth();
+    if (range.count >= numTeeth) {
+        transformLoop(profile, pos, angle, scale, out);
+        return;
+    }
+
+    out.clear();
+    auto toothSize = profile.toothSize();
+    out.reserve(range.count * toothSize + 1);
+    auto c = std::cos(angle) * scale;
+    auto s = std::sin(angle) * scale;
+    auto offset = pos * scale;
+
+    auto addTooth = [&](size_t tooth, size_t numPoints) {
+        // Rotate by the tooth and the gear at once
+        auto r = profile.rotation(tooth);
+        auto tc = c * r.x - s * r.y;
+        auto ts = s * r.x + c * r.y;
+        for (size_t i = 0; i < numPoints; ++i) {
+            auto p = profile.local(i);
+            out.push_back(
+                glm::vec2{tc * p.x - ts * p.y, ts * p.x + tc * p.y} + offset);
+        }
+    };
+
+    for (size_t i = 0; i < range.count; ++i) {
+        addTooth((range.first + i) % numTeeth, toothSize);
+    }
+    addTooth((range.first + range.count) % numTeeth, 1);
+}
+
+void transformMeshTeeth(const GearMesh &mesh,
+                        size_t numTeeth,
+                        ToothRange range,
+                        glm::vec2 pos,
+                        float angle,
+                        float scale,
+                        Color color,
+                        std::vector<MeshVertex> &out,
+                        std::vector<int> &indices) {
+    indices.clear();
+    if (!numTeeth || mesh.vertices.empty()) {
+        out.clear();
+        return;
+    }
+    if (range.count >= numTeeth) {
+        transformMesh(mesh, pos, angle, scale, color, out);
+        indices = mesh.indices;
+        return;
+    }
+
+    out.resize(mesh.vertices.size());
+    auto c = std::cos(angle) * scale;
+    auto s = std::sin(angle) * scale;
+    auto offset = pos * scale;
+    auto transform = [&](size_t i) {
+        auto p = mesh.vertices[i];
+        out[i] = {glm::vec2{c * p.x - s * p.y, s * p.x + c * p.y} + offset,
+                  color,
+                  {}};
+    };
+
+    // See triangulateProfile() for the layout, the triangles of a tooth also
+    // use the first point of the next tooth and the center
+    auto toothSize = (mesh.vertices.size() - 1) / numTeeth;
+    auto toothIndices = mesh.indices.size() / numTeeth;
+    for (size_t i = 0; i <= range.count; ++i) {
+        auto tooth = (range.first + i) % numTeeth;
+        auto first = tooth * toothSize;
+        auto numPoints = i < range.count ? toothSize : 1;
+        for (size_t j = 0; j < numPoints; ++j) {
+            transform(first + j);
+        }
+        if (i < range.count) {
+            auto begin = mesh.indices.begin() + tooth * toothIndices;
+            indices.insert(indices.end(), begin, begin + toothIndices);
+        }
+    }
+    transform(mesh.vertices.size() - 1);
+}
+
+void arcPoints(float r, float start, float end, std::vector<glm::vec2> &out) {
+    out.clear();
+
+    forEachArcSegment(
+        [&out](glm::vec2 p1, glm::vec2 p2) {
+            if (out.empty()) {
+                out.push_back(p1);
+            }
+            out.push_back(p2);
+        },
+        {},
+        r,
+        start,
+        end);
+}
+
+ReferenceCircles::ReferenceCircles(const GearSettings &settings) {
+    auto full = glm::pi<float>() * 2;
+    arcPoints(settings.addendumD / 2, 0, full, addendum);
+    arcPoints(settings.clearingD / 2, 0, full, clearing);
+    arcPoints(settings.dedendumD / 2, 0, full, dedendum);
+    arcPoints(settings.baseD / 2, 0, full, base);
+    arcPoints(settings.pitchD / 2, 0, full, pitch);
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include "color.h"
+#include "compactprofile.h"
+#include "gearmesh.h"
+#include "gearsettings.h"
+#include <cstddef>
+#include <glm/glm.hpp>
+#include <vector>
+
+// Vertex buffers for drawing gears as polylines, without depending on any
+// renderer. The points have the same layout as SDL_FPoint so a buffer can be
+// passed to SDL_RenderDrawLinesF as is
+
+// Rotate the closed loop of a profile by angle, move it to pos and multiply
+// by scale. The memory in out is reused between calls
+template <typename ProfileT>
+void transformLoop(const ProfileT &profile,
+                   glm::vec2 pos,
+                   float angle,
+                   float scale,
+                   std::vector<glm::vec2> &out) {
+    out.clear();
+    out.reserve(profile.size());
+    auto c = std::cos(angle) * scale;
+    auto s = std::sin(angle) * scale;
+    auto offset = pos * scale;
+    for (glm::vec2 p : profile) {
+        out.push_back(
+            glm::vec2{c * p.x - s * p.y, s * p.x + c * p.y} + offset);
+    }
+}
+
+// Teeth first, first + 1, .. first + count - 1, wrapping around after the
+// last tooth
+struct ToothRange {
+    size_t first = 0;
+    size_t count = 0;
+};
+
+// Teeth of a gear at pos, rotated by angle, that can be inside the rectangle
+// from viewMin to viewMax (both in world units)
+//
+// Tooth i of a profile is centered on the angle i * pitchAngle, so the
+// angular range of the rectangle seen from the center of the gear gives the
+// teeth. How far a tooth reaches around the center is measured on the half
+// tooth, since the roots of large gears fold back over the neighbouring
+// teeth. One extra tooth is included on both sides for the segments between
+// the teeth
+ToothRange visibleTeeth(const CompactProfile &profile,
+                        glm::vec2 pos,
+                        float angle,
+                        glm::vec2 viewMin,
+                        glm::vec2 viewMax);
+
+// Same as transformLoop() but only for the teeth in range: an open polyline
+// from the first point of the first tooth to the first point of the tooth
+// after the range. The full closed loop if range covers every tooth
+void transformTeeth(const CompactProfile &profile,
+                    ToothRange range,
+                    glm::vec2 pos,
+                    float angle,
+                    float scale,
+                    std::vector<glm::vec2> &out);
+
+// Same layout as SDL_Vertex, so a buffer can be passed to
+// SDL_RenderGeometry as is
+struct MeshVertex {
+    glm::vec2 position;
+    Color color;
+    glm::vec2 texCoord;
+};
+
+// Rotate the vertices of a mesh by angle, move them to pos and multiply by
+// scale. The indices of the mesh are used unchanged
+void transformMesh(const GearMesh &mesh,
+                   glm::vec2 pos,
+                   float angle,
+                   float scale,
+                   Color color,
+                   std::vector<MeshVertex> &out);
+
+// Same as transformMesh() but only for the teeth in range. out has room for
+// all vertices of the mesh, but only the ones used by the teeth are
+// transformed. The triangles of the teeth are written to indices
+void transformMeshTeeth(const GearMesh &mesh,
+                        size_t numTeeth,
+                        ToothRange range,
+                        glm::vec2 pos,
+                        float angle,
+                        float scale,
+                        Color color,
+                        std::vector<MeshVertex> &out,
+                        std::vector<int> &indices);
+
+// Same as above but for a plain point list
+void transformPoints(const std::vector<glm::vec2> &points,
+                     glm::vec2 pos,
+                     float scale,
+                     std::vector<glm::vec2> &out);
+
+// Polyline for an arc around origin, with the points of forEachArcSegment
+void arcPoints(float r,
+               float start,
+               float end,
+               std::vector<glm::vec2> &out);
+
+// Local space polylines for the reference circles of a gear. Only needs to be
+// recalculated when the settings changes
+struct ReferenceCircles {
+    ReferenceCircles(const GearSettings &settings);
+
+    std::vector<glm::vec2> addendum;
+    std::vector<glm::vec2> clearing;
+    std::vector<glm::vec2> dedendum;
+    std::vector<glm::vec2> base;
+    std::vector<glm::vec2> pitch;
+};
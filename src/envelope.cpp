@@ -0,0 +1,714 @@
+#include "envelope.h"
+#include "geartrain.h"
+#include "threadpool.h"
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <glm/gtc/constants.hpp>
+#include <limits>
+
+namespace {
+
+float cross(glm::vec2 a, glm::vec2 b) {
+    return a.x * b.y - a.y * b.x;
+}
+
+glm::vec2 rotated(glm::vec2 p, float c, float s) {
+    return {c * p.x - s * p.y, s * p.x + c * p.y};
+}
+
+// Distance from the center to the closest point of the segment
+float segmentDistance(glm::vec2 p, glm::vec2 q) {
+    auto e = q - p;
+    auto length2 = glm::dot(e, e);
+    auto t = length2 > 0 ? std::clamp(-glm::dot(p, e) / length2, 0.f, 1.f)
+                         : 0.f;
+    return glm::length(p + e * t);
+}
+
+bool isInsidePolygon(const std::vector<glm::vec2> &polygon, glm::vec2 p) {
+    auto isInside = false;
+    for (size_t i = 0, j = polygon.size() - 1; i < polygon.size(); j = i++) {
+        auto a = polygon[j] - p;
+        auto b = polygon[i] - p;
+        if ((a.y > 0) != (b.y > 0) &&
+            a.x + (b.x - a.x) * a.y / (a.y - b.y) > 0) {
+            isInside = !isInside;
+        }
+    }
+    return isInside;
+}
+
+// The rays of the tooth at angle 0 and the parts of them that were cut away
+//
+// Polygons anywhere around the gear are folded onto the tooth by turning
+// them whole pitches, which is what makes the result the same for every
+// tooth
+struct RayClipper {
+    RayClipper(float pitchAngle, int numRays, float radius)
+        : pitchAngle{pitchAngle}
+        , radius{radius}
+        , cuts(numRays)
+        , directions(numRays) {
+        for (int i = 0; i < numRays; ++i) {
+            auto angle = pitchAngle * ((i + .5f) / numRays - .5f);
+            directions[i] = {std::cos(angle), std::sin(angle)};
+        }
+    }
+
+    // Cut away the inside of a closed polygon, after transforming every
+    // point with transform(p). The polygon must not contain the center
+    //
+    // Every ray enters and leaves the polygon an even number of times, and
+    // each pair of crossings along the ray is one interval that is cut. Only
+    // the crossings inside the blank are kept, so if a ray has an odd number
+    // the last interval reaches past the blank
+    template <typename F>
+    void clipPolygon(const std::vector<glm::vec2> &polygon, F transform) {
+        if (polygon.size() < 3) {
+            return;
+        }
+        points.clear();
+        auto isOutside = true;
+        for (auto &p : polygon) {
+            points.push_back(transform(p));
+            isOutside = isOutside && glm::length(points.back()) >= radius;
+        }
+        for (size_t i = 0; isOutside && i < points.size(); ++i) {
+            auto q = points[(i + 1) % points.size()];
+            isOutside = segmentDistance(points[i], q) >= radius;
+        }
+        // The center is outside, so the blank is too
+        if (isOutside) {
+            return;
+        }
+
+        // The angles of the points without any wrapping around, so that both
+        // edges at a point see it at exactly the same angle
+        auto full = glm::pi<float>() * 2;
+        angles.resize(points.size());
+        angles[0] = std::atan2(points[0].y, points[0].x);
+        for (size_t i = 1; i < points.size(); ++i) {
+            auto angle = std::atan2(points[i].y, points[i].x);
+            angles[i] =
+                angle + full * std::round((angles[i - 1] - angle) / full);
+        }
+
+        crossings.clear();
+        for (size_t i = 0; i < points.size(); ++i) {
+            auto next = (i + 1) % points.size();
+            addCrossings(points[i], points[next], angles[i], angles[next]);
+        }
+
+        std::sort(crossings.begin(),
+                  crossings.end(),
+                  [](const Crossing &a, const Crossing &b) {
+                      return a.ray != b.ray ? a.ray < b.ray : a.t < b.t;
+                  });
+        auto n = static_cast<int>(cuts.size());
+        for (size_t i = 0; i < crossings.size();) {
+            auto ray = crossings[i].ray;
+            auto isPair =
+                i + 1 < crossings.size() && crossings[i + 1].ray == ray;
+            cut((ray % n + n) % n,
+                crossings[i].t,
+                isPair ? crossings[i + 1].t : radius);
+            i += isPair ? 2 : 1;
+        }
+    }
+
+    // Cut [from, to] from ray i, merging it with the cuts it overlaps
+    void cut(int i, float from, float to) {
+        if (from >= radius || to <= from) {
+            return;
+        }
+        auto &ray = cuts[i];
+        auto first = std::lower_bound(
+            ray.begin(), ray.end(), from, [](const RayInterval &a, float r) {
+                return a.to < r;
+            });
+        auto last = first;
+        for (; last != ray.end() && last->from <= to; ++last) {
+            from = std::min(from, last->from);
+            to = std::max(to, last->to);
+        }
+        if (first == last) {
+            ray.insert(first, {from, to});
+        }
+        else {
+            *first = {from, to};
+            ray.erase(first + 1, last);
+        }
+    }
+
+    void merge(const RayClipper &other) {
+        for (size_t i = 0; i < cuts.size(); ++i) {
+            for (auto &interval : other.cuts[i]) {
+                cut(static_cast<int>(i), interval.from, interval.to);
+            }
+        }
+    }
+
+    // What is left of the blank on ray i
+    std::vector<RayInterval> material(size_t i) const {
+        auto result = std::vector<RayInterval>{};
+        auto from = 0.f;
+        for (auto &interval : cuts[i]) {
+            if (interval.from > from) {
+                result.push_back({from, interval.from});
+            }
+            from = interval.to;
+        }
+        if (from < radius) {
+            result.push_back({from, radius});
+        }
+        return result;
+    }
+
+    float pitchAngle;
+    // Radius of the blank, nothing outside it is cut
+    float radius;
+    // Sorted and not overlapping
+    std::vector<std::vector<RayInterval>> cuts;
+    std::vector<glm::vec2> directions;
+
+private:
+    struct Crossing {
+        // Not folded onto the tooth, so that the crossings of different
+        // turns are never paired
+        int ray;
+        float t;
+    };
+
+    // Rays at or after the lower angle and before the higher one, so that a
+    // ray through a point of the polygon crosses one of the edges there if
+    // it passes through, and none or both if it only touches it
+    void addCrossings(glm::vec2 p, glm::vec2 q, float from, float to) {
+        if (segmentDistance(p, q) >= radius) {
+            return;
+        }
+        auto n = static_cast<int>(cuts.size());
+        auto step = pitchAngle / n;
+        auto first = static_cast<int>(
+            std::ceil(std::min(from, to) / step + n / 2.f - .5f));
+        auto end = static_cast<int>(
+            std::ceil(std::max(from, to) / step + n / 2.f - .5f));
+
+        auto e = q - p;
+        auto turn = std::numeric_limits<int>::min();
+        auto turnedP = p;
+        auto turnedE = e;
+        for (auto j = first; j < end; ++j) {
+            auto jTurn = j >= 0 ? j / n : -((n - 1 - j) / n);
+            if (jTurn != turn) {
+                turn = jTurn;
+                auto angle = -pitchAngle * turn;
+                auto c = std::cos(angle);
+                auto s = std::sin(angle);
+                turnedP = rotated(p, c, s);
+                turnedE = rotated(e, c, s);
+            }
+            auto i = j - turn * n;
+            auto denominator = cross(directions[i], turnedE);
+            auto t = denominator != 0 ? cross(turnedP, turnedE) / denominator
+                                      : glm::length(p);
+            if (t < radius) {
+                crossings.push_back({j, std::max(t, 0.f)});
+            }
+        }
+    }
+
+    // Scratch space for clipPolygon()
+    std::vector<glm::vec2> points;
+    std::vector<float> angles;
+    std::vector<Crossing> crossings;
+};
+
+// One tooth of the rack in modules, as (u, h) with u along the rack and h
+// from the reference line towards the center of the gear. top is where the
+// tooth is closed off, outside the blank
+std::vector<glm::vec2> rackTooth(const RackCutter &rack,
+                                 float preassureAngle,
+                                 float top) {
+    auto angle = preassureAngle / 180.f * glm::pi<float>();
+    auto slope = std::tan(angle);
+    auto halfWidth = glm::pi<float>() / 4.f;
+
+    // Teeth that would get pointed before reaching the depth end at the point
+    auto depth = std::min(rack.dedendum, halfWidth / slope);
+
+    // Largest rounding that fits between the flanks
+    auto maxRadius =
+        (halfWidth - depth * slope) / (1.f / std::cos(angle) - slope);
+    auto radius = std::clamp(rack.tipRadius, 0.f, maxRadius);
+
+    // The right side, from the top down to the middle of the tip
+    auto side = std::vector<glm::vec2>{};
+    side.push_back({halfWidth + top * slope, -top});
+    if (radius > 0) {
+        // Center of the rounding, touching both the tip and the flank
+        auto center =
+            glm::vec2{halfWidth - (depth - radius) * slope -
+                          radius / std::cos(angle),
+                      depth - radius};
+        auto segments = std::max(1, rack.tipSegments);
+        for (int i = 0; i <= segments; ++i) {
+            auto a = angle + (glm::pi<float>() / 2.f - angle) * i / segments;
+            side.push_back(center + glm::vec2{std::cos(a), std::sin(a)} *
+                                        radius);
+        }
+    }
+    else {
+        side.push_back({halfWidth - depth * slope, depth});
+    }
+
+    auto polygon = side;
+    for (auto it = side.rbegin(); it != side.rend(); ++it) {
+        polygon.push_back({-it->x, it->y});
+    }
+    return polygon;
+}
+
+// The outline of one tooth as (angle, radius), from the middle of the gap
+// before it to the middle of the gap after it
+//
+// The intervals of every ray are runs of material, and the outline goes
+// around the runs that are connected to the center with the material on the
+// same side: towards larger angles along the outer ends of the runs, and
+// back towards smaller angles along the inner ends of runs that overhang an
+// undercut. At the end of a run it turns to the run on the neighbouring ray
+// that the material continues in. The rays next to the tooth are those of
+// the neighbouring teeth, since every tooth is the same
+std::vector<glm::vec2> traceTooth(const EnvelopeProfile &profile) {
+    auto outline = std::vector<glm::vec2>{};
+    auto &material = profile.material;
+    auto n = static_cast<int>(material.size());
+    if (n == 0 || material.front().empty()) {
+        return outline;
+    }
+
+    auto column = [&](int c) -> const std::vector<RayInterval> & {
+        return material[(c % n + n) % n];
+    };
+    auto angle = [&](int c) {
+        auto turn = c >= 0 ? c / n : -((n - 1 - c) / n);
+        return profile.settings.pitchAngle * turn +
+               profile.rayAngle(c - turn * n);
+    };
+
+    // Every end of a run is passed at most once per tooth, which limits the
+    // steps if the runs do not reach the next tooth
+    auto maxSteps = size_t{0};
+    for (auto &runs : material) {
+        maxSteps += 4 * runs.size();
+    }
+
+    // Start at the root in the middle of the gap, at the outer end of the
+    // run from the center
+    auto c = 0;
+    auto run = size_t{0};
+    auto isOuter = true;
+    for (size_t step = 0; step < maxSteps; ++step) {
+        if (c == n && run == 0 && isOuter) {
+            break;
+        }
+        auto &runs = column(c);
+        auto current = runs[run];
+        outline.push_back({angle(c), isOuter ? current.to : current.from});
+
+        if (isOuter) {
+            // The outer end of the run, heading to larger angles
+            auto &next = column(c + 1);
+            auto above = std::find_if(
+                next.begin(), next.end(), [&](const RayInterval &r) {
+                    return r.from <= current.to && current.to < r.to;
+                });
+            if (above != next.end()) {
+                // The next ray goes on further out, unless the run above on
+                // this ray gets there first
+                if (run + 1 < runs.size() && runs[run + 1].from < above->to) {
+                    ++run;
+                    isOuter = false;
+                }
+                else {
+                    ++c;
+                    run = above - next.begin();
+                }
+                continue;
+            }
+            // The highest run of the next ray that ends within this run
+            auto below = std::find_if(
+                next.rbegin(), next.rend(), [&](const RayInterval &r) {
+                    return current.from < r.to && r.to <= current.to;
+                });
+            if (below != next.rend()) {
+                ++c;
+                run = next.rend() - below - 1;
+            }
+            else {
+                isOuter = false;
+            }
+        }
+        else {
+            // The inner end of the run, heading to smaller angles
+            auto &previous = column(c - 1);
+            auto below = std::find_if(
+                previous.begin(), previous.end(), [&](const RayInterval &r) {
+                    return r.from < current.from && current.from <= r.to;
+                });
+            if (below != previous.end()) {
+                // The previous ray goes on further in, unless the run below
+                // on this ray gets there first
+                if (run > 0 && runs[run - 1].to > below->from) {
+                    --run;
+                    isOuter = true;
+                }
+                else {
+                    --c;
+                    run = below - previous.begin();
+                }
+                continue;
+            }
+            // The lowest run of the previous ray that starts within this run
+            auto above = std::find_if(
+                previous.begin(), previous.end(), [&](const RayInterval &r) {
+                    return current.from <= r.from && r.from < current.to;
+                });
+            if (above != previous.end()) {
+                --c;
+                run = above - previous.begin();
+            }
+            else {
+                isOuter = true;
+            }
+        }
+    }
+    return outline;
+}
+
+// The pinion cutter, which is itself cut by the rack with its addendum and
+// dedendum swapped
+EnvelopeProfile pinionCutter(const GearSettings &settings,
+                             const EnvelopeOptions &options,
+                             ThreadPool *pool) {
+    auto cutter = GearSettings{.numTeeth = options.cutterTeeth,
+                               .module = settings.module,
+                               .preassureAngle = settings.preassureAngle};
+    auto cutterOptions = EnvelopeOptions{};
+    cutterOptions.rack.addendum = options.rack.dedendum;
+    cutterOptions.rack.dedendum = options.rack.addendum + .25f;
+    cutterOptions.numPositions = options.numPositions;
+    cutterOptions.numRays = options.numRays;
+    return generateEnvelope(cutter, cutterOptions, pool);
+}
+
+// The edges of the outline from points() between every two neighbouring
+// rays, as the radii on the two rays. A point is inside the outline if an
+// odd number of the edges around its angle pass outside of it
+struct OutlineCrossings {
+    explicit OutlineCrossings(const EnvelopeProfile &profile)
+        : pitchAngle{profile.settings.pitchAngle}
+        , gaps(profile.material.size()) {
+        auto tooth = traceTooth(profile);
+        if (tooth.empty()) {
+            return;
+        }
+        // On to the first point of the next tooth
+        tooth.push_back({tooth.front().x + pitchAngle, tooth.front().y});
+        // The outline steps from one ray to the next or stays on the ray
+        auto n = static_cast<long>(gaps.size());
+        auto ray = [&](glm::vec2 p) { return std::lround(position(p.x)); };
+        for (size_t i = 1; i < tooth.size(); ++i) {
+            auto a = tooth[i - 1];
+            auto b = tooth[i];
+            if (ray(a) == ray(b)) {
+                continue;
+            }
+            if (ray(a) > ray(b)) {
+                std::swap(a, b);
+            }
+            gaps[(ray(a) % n + n) % n].push_back({a.y, b.y});
+        }
+    }
+
+    // Position of an angle in rays, counting on into the next teeth
+    float position(float angle) const {
+        return (angle / pitchAngle + .5f) * gaps.size() - .5f;
+    }
+
+    bool isInside(glm::vec2 p) const {
+        if (gaps.empty()) {
+            return false;
+        }
+        auto x = position(std::remainder(std::atan2(p.y, p.x), pitchAngle));
+        auto first = std::floor(x);
+        auto f = x - first;
+        auto n = static_cast<long>(gaps.size());
+        auto &edges = gaps[(static_cast<long>(first) + n) % n];
+
+        auto r = glm::length(p);
+        auto isInside = false;
+        for (auto &edge : edges) {
+            if (edge.x + (edge.y - edge.x) * f > r) {
+                isInside = !isInside;
+            }
+        }
+        return isInside;
+    }
+
+    float pitchAngle = 0;
+    std::vector<std::vector<glm::vec2>> gaps;
+};
+
+} // namespace
+
+float EnvelopeProfile::rootRadius() const {
+    auto radius = std::numeric_limits<float>::infinity();
+    for (auto &runs : material) {
+        if (!runs.empty()) {
+            radius = std::min(radius, runs.front().to);
+        }
+    }
+    return material.empty() ? 0.f : radius;
+}
+
+float EnvelopeProfile::tipRadius() const {
+    auto radius = 0.f;
+    for (auto &runs : material) {
+        if (!runs.empty()) {
+            radius = std::max(radius, runs.back().to);
+        }
+    }
+    return radius;
+}
+
+std::vector<glm::vec2> EnvelopeProfile::points() const {
+    auto tooth = traceTooth(*this);
+    auto loop = std::vector<glm::vec2>{};
+    loop.reserve(settings.numTeeth * tooth.size() + 1);
+    for (int i = 0; i < settings.numTeeth; ++i) {
+        for (auto &p : tooth) {
+            auto angle = settings.pitchAngle * i + p.x;
+            loop.push_back(glm::vec2{std::cos(angle), std::sin(angle)} * p.y);
+        }
+    }
+    if (!loop.empty()) {
+        loop.push_back(loop.front());
+    }
+    return loop;
+}
+
+EnvelopeProfile generateEnvelope(const GearSettings &settings,
+                                 const EnvelopeOptions &options,
+                                 ThreadPool *pool) {
+    auto profile = EnvelopeProfile{settings, options, {}};
+    auto numRays = std::max(1, options.numRays);
+    auto numPositions = std::max(1, options.numPositions);
+
+    auto module = static_cast<float>(settings.module);
+    auto pitchRadius = settings.pitchD / 2.f;
+    // The reference line, or the pitch circle of the pinion, rolls on the
+    // pitch circle moved out by the profile shift
+    auto reference = pitchRadius + options.profileShift * module;
+    auto blankRadius = reference + options.rack.addendum * module;
+
+    // Every position transforms the cutter into the coordinates of the gear
+    // and clips the rays with it
+    auto polygon = std::vector<glm::vec2>{};
+    auto cut = std::function<void(RayClipper &, float)>{};
+
+    auto cutter = GearSettings{};
+    if (options.cutterTeeth > 0) {
+        auto cutterProfile = pinionCutter(settings, options, pool);
+        cutter = cutterProfile.settings;
+        polygon = cutterProfile.points();
+        polygon.pop_back(); // The closing point
+
+        auto distance = reference + cutter.pitchD / 2.f;
+        cut = [&polygon, &settings, &cutter, distance](RayClipper &clipper,
+                                                       float angle) {
+            auto turn = meshingAngle(settings, angle, cutter, 0) - angle;
+            auto c = std::cos(turn);
+            auto s = std::sin(turn);
+            auto center = rotated({distance, 0}, std::cos(angle),
+                                  -std::sin(angle));
+            clipper.clipPolygon(polygon, [&](glm::vec2 p) {
+                return center + rotated(p, c, s);
+            });
+        };
+    }
+    else {
+        // Closed off a module outside the blank, where the crossings do not
+        // cut anything
+        polygon = rackTooth(options.rack,
+                            settings.preassureAngle,
+                            options.rack.addendum + 1);
+        for (auto &p : polygon) {
+            p *= module;
+        }
+
+        // Rack teeth that can reach the blank at any position in the pitch
+        auto rackPitch = glm::pi<float>() * module;
+        auto lastTooth = static_cast<int>(std::ceil(blankRadius / rackPitch));
+        auto firstTooth = -lastTooth - 2;
+
+        cut = [&polygon,
+               firstTooth,
+               lastTooth,
+               rackPitch,
+               pitchRadius,
+               reference](RayClipper &clipper, float angle) {
+            auto c = std::cos(-angle);
+            auto s = std::sin(-angle);
+            // The rack moves along the pitch circle as the gear turns
+            auto shift = pitchRadius * angle;
+            for (auto tooth = firstTooth; tooth <= lastTooth; ++tooth) {
+                auto center = (tooth + .5f) * rackPitch + shift;
+                clipper.clipPolygon(polygon, [&](glm::vec2 p) {
+                    return rotated({reference - p.y, center + p.x}, c, s);
+                });
+            }
+        };
+    }
+
+    auto numChunks = pool ? std::min<size_t>(pool->size(), numPositions) : 1;
+    auto clippers = std::vector<RayClipper>(
+        numChunks, RayClipper{settings.pitchAngle, numRays, blankRadius});
+    auto cutChunk = [&](size_t chunk) {
+        auto begin = numPositions * chunk / numChunks;
+        auto end = numPositions * (chunk + 1) / numChunks;
+        for (auto i = begin; i < end; ++i) {
+            cut(clippers[chunk],
+                settings.pitchAngle * static_cast<float>(i) / numPositions);
+        }
+    };
+    if (pool) {
+        pool->parallelFor(numChunks, cutChunk, 1);
+    }
+    else {
+        cutChunk(0);
+    }
+
+    for (size_t i = 1; i < clippers.size(); ++i) {
+        clippers.front().merge(clippers[i]);
+    }
+    profile.material.resize(numRays);
+    for (int i = 0; i < numRays; ++i) {
+        profile.material[i] = clippers.front().material(i);
+    }
+    return profile;
+}
+
+float verifyEnvelope(const EnvelopeProfile &profile,
+                     ThreadPool *pool,
+                     int numRays,
+                     int numRadii) {
+    auto &settings = profile.settings;
+    auto &options = profile.options;
+    if (profile.material.empty()) {
+        return 0;
+    }
+    numRays = std::clamp(numRays, 1, static_cast<int>(profile.material.size()));
+    numRadii = std::max(1, numRadii);
+
+    auto module = static_cast<float>(settings.module);
+    auto pitchRadius = settings.pitchD / 2.f;
+    auto reference = pitchRadius + options.profileShift * module;
+    auto blankRadius = reference + options.rack.addendum * module;
+    auto inner = reference - (options.rack.dedendum + .25f) * module;
+    auto outer = blankRadius + .25f * module;
+
+    auto top = options.rack.addendum + 1;
+    auto rack = rackTooth(options.rack, settings.preassureAngle, top);
+    for (auto &p : rack) {
+        p *= module;
+    }
+    auto rackPitch = glm::pi<float>() * module;
+    auto numPositions = std::max(1, options.numPositions);
+    auto numTurnPositions = numPositions * settings.numTeeth;
+
+    // Whether the point of the gear is inside any tooth of the rack at any
+    // position over the turn
+    auto isCutByRack = [&](glm::vec2 p) {
+        for (int i = 0; i < numTurnPositions; ++i) {
+            auto angle =
+                settings.pitchAngle * static_cast<float>(i) / numPositions;
+            auto v = rotated(p, std::cos(angle), std::sin(angle));
+            auto h = reference - v.x;
+            if (h > options.rack.dedendum * module || h < -top * module) {
+                continue;
+            }
+            auto u = v.y - pitchRadius * angle;
+            auto tooth = std::floor(u / rackPitch);
+            for (auto t = tooth - 1; t <= tooth + 1; ++t) {
+                if (isInsidePolygon(rack, {u - (t + .5f) * rackPitch, h})) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    };
+
+    // The same for the pinion cutter, which is generated again
+    auto cutter = EnvelopeProfile{};
+    if (options.cutterTeeth > 0) {
+        cutter = pinionCutter(settings, options, pool);
+    }
+    auto outline = OutlineCrossings{cutter};
+    auto distance = reference + cutter.settings.pitchD / 2.f;
+    auto cutterRadius = cutter.tipRadius();
+    auto isCutByPinion = [&](glm::vec2 p) {
+        for (int i = 0; i < numTurnPositions; ++i) {
+            auto angle =
+                settings.pitchAngle * static_cast<float>(i) / numPositions;
+            auto center =
+                rotated({distance, 0}, std::cos(angle), -std::sin(angle));
+            auto v = p - center;
+            if (glm::length(v) > cutterRadius) {
+                continue;
+            }
+            auto turn =
+                meshingAngle(settings, angle, cutter.settings, 0) - angle;
+            if (outline.isInside(
+                    rotated(v, std::cos(turn), -std::sin(turn)))) {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    auto isCut = [&](glm::vec2 p) {
+        return options.cutterTeeth > 0 ? isCutByPinion(p) : isCutByRack(p);
+    };
+
+    auto errors = std::vector<float>(numRays);
+    auto checkRay = [&](size_t k) {
+        auto i = k * profile.material.size() / numRays;
+        auto &runs = profile.material[i];
+        auto angle = profile.rayAngle(i);
+        auto direction = glm::vec2{std::cos(angle), std::sin(angle)};
+        for (int row = 0; row < numRadii; ++row) {
+            auto r = inner + (outer - inner) * (row + .5f) / numRadii;
+            auto isMaterial = r <= blankRadius && !isCut(direction * r);
+            auto error = std::numeric_limits<float>::infinity();
+            auto isInRuns = false;
+            for (auto &run : runs) {
+                isInRuns = isInRuns || (run.from <= r && r <= run.to);
+                error = std::min(
+                    {error, std::abs(r - run.from), std::abs(r - run.to)});
+            }
+            if (isMaterial != isInRuns) {
+                errors[k] = std::max(errors[k], error);
+            }
+        }
+    };
+    if (pool) {
+        pool->parallelFor(numRays, checkRay);
+    }
+    else {
+        for (int k = 0; k < numRays; ++k) {
+            checkRay(k);
+        }
+    }
+    return *std::max_element(errors.begin(), errors.end());
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include "gearsettings.h"
+#include <cstddef>
+#include <glm/glm.hpp>
+#include <vector>
+
+class ThreadPool;
+
+// Straight sided rack that the gear is rolled along, in units of the module
+// and measured from the reference line, where the teeth of the rack are
+// exactly half a pitch wide
+struct RackCutter {
+    // Radius of the blank that is cut, relative to the reference line. The
+    // gear gets the tips of GearSettings::addendumD when this is 1
+    float addendum = 1;
+
+    // How deep the cutter goes, which gives the root circle. 1.5 gives
+    // GearSettings::dedendumD
+    float dedendum = 1.5;
+
+    // Rounded corners at the tips of the rack teeth, which cut the fillets
+    // at the roots of the gear. Made smaller if it does not fit
+    float tipRadius = 0;
+    int tipSegments = 8;
+};
+
+struct EnvelopeOptions {
+    RackCutter rack;
+
+    // Profile shift coefficient: the reference line of the cutter is moved
+    // this many modules away from the center of the gear. Positive shifts
+    // avoid undercut on gears with few teeth
+    float profileShift = 0;
+
+    // Teeth of a pinion shaped cutter (a shaper) with the same module and
+    // preassure angle, 0 to cut with the rack. The pinion is itself cut by
+    // the rack, with its addendum and dedendum swapped, so that it reaches
+    // as deep as the rack
+    int cutterTeeth = 0;
+
+    // Tool positions over one pitch of the gear. Every position is one
+    // instant of the cut, so fewer positions leave scallops on the flanks
+    int numPositions = 360;
+
+    // Rays per tooth that the result is sampled on
+    int numRays = 1024;
+};
+
+// Part of a ray from the center, as distances from the center
+struct RayInterval {
+    float from = 0;
+    float to = 0;
+};
+
+// Gear cut by simulating a generating cutter instead of from the involute
+// formula
+//
+// The gear is stored in polar form: for every ray from the center, the parts
+// of the ray that are left after the cut, from the center outwards. Most
+// rays have one, from the center to the outline. Rays through the undercut
+// of gears with few teeth have two, the material below the undercut and the
+// part of the flank that overhangs it
+struct EnvelopeProfile {
+    GearSettings settings;
+    EnvelopeOptions options;
+
+    // The material on every ray over the tooth centered at angle 0, sorted
+    // and not overlapping, see rayAngle()
+    std::vector<std::vector<RayInterval>> material;
+
+    float rayAngle(size_t i) const {
+        return settings.pitchAngle *
+               ((static_cast<float>(i) + .5f) / material.size() - .5f);
+    }
+
+    // Where the first ray leaves the material, which is the root circle
+    float rootRadius() const;
+
+    // End of the material furthest out, which is the tip circle
+    float tipRadius() const;
+
+    // Closed loop over all teeth, in the same orientation as
+    // GearProfile::points, with the first point repeated at the end
+    //
+    // The outline follows the ends of the intervals from ray to ray, around
+    // the material that is connected to the center. Where the flank
+    // overhangs the undercut it goes back along the underside of the
+    // overhang and out again along the bottom of the undercut, so the loop
+    // is not star shaped there
+    std::vector<glm::vec2> points() const;
+};
+
+// Roll the cutter along the blank and cut away, on every ray, the parts that
+// any of the cutter positions covers
+//
+// Rotating the gear one pitch moves the cutter to where the next tooth was,
+// so the positions only need to cover one pitch, and every cutter edge is
+// folded onto the rays of the tooth at angle 0. The positions are split
+// between the threads of the pool, each with its own rays, and the cuts are
+// merged as the union of the intervals, so the result does not depend on the
+// number of threads
+EnvelopeProfile generateEnvelope(const GearSettings &settings,
+                                 const EnvelopeOptions &options = {},
+                                 ThreadPool *pool = nullptr);
+
+// Check a profile against a brute force test, for numRays of its rays at
+// numRadii radii from inside the root to outside the blank. A point is
+// material if it is inside the blank and outside the cutter at every
+// position over a full turn of the gear, without any folding. The rack is
+// endless, and the pinion cutter is generated again and tested against the
+// outline that it cuts with
+//
+// Returns the largest distance along a ray from a point that the two
+// disagree about to the closest end of an interval, 0 if they agree
+// everywhere
+float verifyEnvelope(const EnvelopeProfile &profile,
+                     ThreadPool *pool = nullptr,
+                     int numRays = 256,
+                     int numRadii = 64);
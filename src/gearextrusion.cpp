@@ -0,0 +1,305 @@
+#include "gearextrusion.h"
+#include "gearmesh.h"
+#include "threadpool.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <glm/gtc/constants.hpp>
+#include <vector>
+
+namespace {
+
+// Normal, three corners and a 16 bit attribute
+constexpr size_t stlTriangleSize = 50;
+
+// Binary STL is little endian, like every platform this is built for
+void putTriangle(std::vector<char> &out,
+                 glm::vec3 a,
+                 glm::vec3 b,
+                 glm::vec3 c) {
+    auto n = glm::cross(b - a, c - a);
+    auto length = glm::length(n);
+    n = length > 0 ? n / length : glm::vec3{0, 0, 0};
+
+    float values[12] = {
+        n.x, n.y, n.z, a.x, a.y, a.z, b.x, b.y, b.z, c.x, c.y, c.z};
+    auto size = out.size();
+    out.resize(size + stlTriangleSize);
+    std::memcpy(out.data() + size, values, sizeof(values));
+    out[size + 48] = 0;
+    out[size + 49] = 0;
+}
+
+glm::vec2 rotated(glm::vec2 p, float c, float s) {
+    return {c * p.x - s * p.y, s * p.x + c * p.y};
+}
+
+// Everything the layers and caps are built from
+struct Extrusion {
+    Extrusion(const CompactProfile &profile, const ExtrusionOptions &options)
+        : options{resolveExtrusion(profile.settings, options)}
+        , numTeeth{profile.numTeeth()}
+        , toothSize{profile.toothSize()} {
+        loop.reserve(numTeeth * toothSize);
+        profile.forEachPoint([this](glm::vec2 p) { loop.push_back(p); });
+        loop.pop_back(); // The closing point
+
+        auto r = profile.settings.pitchD / 2.f;
+        auto helix = this->options.helixAngle / 180.f * glm::pi<float>();
+        twist = this->options.height * std::tan(helix) / r;
+
+        if (this->options.boreDiameter > 0) {
+            auto n = this->options.boreSegments;
+            bore.resize(n);
+            for (int i = 0; i < n; ++i) {
+                auto angle = glm::pi<float>() * 2.f * i / n;
+                bore[i] = glm::vec2{std::cos(angle), std::sin(angle)} *
+                          (this->options.boreDiameter / 2.f);
+            }
+        }
+    }
+
+    // Loop point i of the layer boundary at height z
+    glm::vec3 point(size_t i, float z, float c, float s) const {
+        return {rotated(loop[i], c, s), z};
+    }
+
+    float layerZ(int layer) const {
+        return options.height * layer / options.numLayers;
+    }
+
+    float layerTwist(int layer) const {
+        return twist * layer / options.numLayers;
+    }
+
+    ExtrusionOptions options;
+    size_t numTeeth;
+    size_t toothSize;
+    // The profile loop without the closing point
+    std::vector<glm::vec2> loop;
+    std::vector<glm::vec2> bore;
+    // Total rotation from the bottom to the top, in radians
+    float twist = 0;
+};
+
+// Two triangles for every loop segment between the boundaries of a layer
+void layerTriangles(const Extrusion &extrusion,
+                    int layer,
+                    std::vector<char> &out) {
+    out.clear();
+    auto z0 = extrusion.layerZ(layer);
+    auto z1 = extrusion.layerZ(layer + 1);
+    auto c0 = std::cos(extrusion.layerTwist(layer));
+    auto s0 = std::sin(extrusion.layerTwist(layer));
+    auto c1 = std::cos(extrusion.layerTwist(layer + 1));
+    auto s1 = std::sin(extrusion.layerTwist(layer + 1));
+
+    auto n = extrusion.loop.size();
+    out.reserve(n * 2 * stlTriangleSize);
+    auto a0 = extrusion.point(0, z0, c0, s0);
+    auto a1 = extrusion.point(0, z1, c1, s1);
+    for (size_t i = 0; i < n; ++i) {
+        auto next = (i + 1) % n;
+        auto b0 = extrusion.point(next, z0, c0, s0);
+        auto b1 = extrusion.point(next, z1, c1, s1);
+        // The loop is counter clockwise, so outwards is to the right
+        putTriangle(out, a0, b0, b1);
+        putTriangle(out, a0, b1, a1);
+        a0 = b0;
+        a1 = b1;
+    }
+}
+
+// Straight bore wall through all layers, facing the hole
+void boreTriangles(const Extrusion &extrusion, std::vector<char> &out) {
+    out.clear();
+    auto &bore = extrusion.bore;
+    // Exactly the height of the top layer, so the edges meet the cap
+    auto height = extrusion.layerZ(extrusion.options.numLayers);
+    for (size_t i = 0; i < bore.size(); ++i) {
+        auto a = bore[i];
+        auto b = bore[(i + 1) % bore.size()];
+        putTriangle(out, {a, 0}, {b, height}, {b, 0});
+        putTriangle(out, {a, 0}, {a, height}, {b, height});
+    }
+}
+
+// Bottom (layer 0) or top cap. The teeth use the strips from the mesh, and
+// the hub is either the fan to the center from the mesh or, with a bore, a
+// band that zips the tooth bases to the bore by angle
+void capTriangles(const Extrusion &extrusion,
+                  const GearMesh &mesh,
+                  bool isTop,
+                  std::vector<char> &out) {
+    out.clear();
+    auto layer = isTop ? extrusion.options.numLayers : 0;
+    auto z = extrusion.layerZ(layer);
+    auto c = std::cos(extrusion.layerTwist(layer));
+    auto s = std::sin(extrusion.layerTwist(layer));
+
+    // Faces up for the top cap and down for the bottom. Points are already
+    // turned with the layer
+    auto triangle = [&](glm::vec2 a, glm::vec2 b, glm::vec2 d) {
+        if (isTop) {
+            putTriangle(out, {a, z}, {b, z}, {d, z});
+        }
+        else {
+            putTriangle(out, {a, z}, {d, z}, {b, z});
+        }
+    };
+    auto &loop = extrusion.loop;
+    auto point = [&](size_t i) { return rotated(loop[i], c, s); };
+
+    // Mesh vertices are the loop points, see triangulateProfile()
+    auto hasBore = !extrusion.bore.empty();
+    auto toothIndices = mesh.indices.size() / extrusion.numTeeth;
+    for (size_t tooth = 0; tooth < extrusion.numTeeth; ++tooth) {
+        // The first two triangles of every tooth are the hub
+        auto first = tooth * toothIndices + (hasBore ? 6 : 0);
+        auto last = (tooth + 1) * toothIndices;
+        for (auto i = first; i < last; i += 3) {
+            auto vertex = [&](size_t index) {
+                auto v = static_cast<size_t>(mesh.indices[index]);
+                return v < loop.size() ? point(v) : glm::vec2{0, 0};
+            };
+            triangle(vertex(i), vertex(i + 1), vertex(i + 2));
+        }
+    }
+    if (!hasBore) {
+        return;
+    }
+
+    // The bore does not turn with the layers
+    auto &bore = extrusion.bore;
+
+    // The first and last point of every tooth, counter clockwise
+    auto base = std::vector<glm::vec2>{};
+    base.reserve(extrusion.numTeeth * 2);
+    for (size_t tooth = 0; tooth < extrusion.numTeeth; ++tooth) {
+        base.push_back(point(tooth * extrusion.toothSize));
+        base.push_back(point((tooth + 1) * extrusion.toothSize - 1));
+    }
+
+    // Angles counted counter clockwise from the first base point
+    auto full = glm::pi<float>() * 2;
+    auto start = std::atan2(base.front().y, base.front().x);
+    auto angleOf = [start, full](glm::vec2 p) {
+        auto a = std::fmod(std::atan2(p.y, p.x) - start, full);
+        return a < 0 ? a + full : a;
+    };
+
+    auto firstBore = size_t{0};
+    for (size_t i = 1; i < bore.size(); ++i) {
+        if (angleOf(bore[i]) < angleOf(bore[firstBore])) {
+            firstBore = i;
+        }
+    }
+
+    auto numBase = base.size();
+    auto numBore = bore.size();
+    auto baseAngle = [&](size_t i) {
+        return i == numBase ? full : angleOf(base[i]);
+    };
+    auto borePoint = [&](size_t i) {
+        return bore[(firstBore + i) % numBore];
+    };
+    auto boreAngle = [&](size_t i) {
+        return angleOf(borePoint(i)) + (i >= numBore ? full : 0);
+    };
+
+    for (size_t i = 0, j = 0; i < numBase || j < numBore;) {
+        auto isBaseNext = j == numBore ||
+                          (i < numBase && baseAngle(i + 1) <= boreAngle(j + 1));
+        if (isBaseNext) {
+            triangle(borePoint(j), base[i], base[(i + 1) % numBase]);
+            ++i;
+        }
+        else {
+            triangle(base[i % numBase], borePoint(j + 1), borePoint(j));
+            ++j;
+        }
+    }
+}
+
+} // namespace
+
+ExtrusionOptions resolveExtrusion(const GearSettings &settings,
+                                  ExtrusionOptions options) {
+    if (options.numLayers <= 0) {
+        auto r = settings.pitchD / 2.f;
+        auto helix = options.helixAngle / 180.f * glm::pi<float>();
+        auto twist = std::abs(options.height * std::tan(helix) / r);
+        auto degree = glm::pi<float>() / 180.f;
+        options.numLayers =
+            std::max(1, static_cast<int>(std::ceil(twist / degree)));
+    }
+    if (options.boreDiameter > 0 && options.boreSegments <= 0) {
+        options.boreSegments = std::max(64, settings.numTeeth * 2);
+    }
+    return options;
+}
+
+size_t extrusionTriangleCount(const CompactProfile &profile,
+                              const ExtrusionOptions &options) {
+    auto resolved = resolveExtrusion(profile.settings, options);
+    auto numTeeth = profile.numTeeth();
+    auto loopSize = numTeeth * profile.toothSize();
+    auto halfTooth = profile.toothSize() / 2;
+
+    auto sides = static_cast<size_t>(resolved.numLayers) * loopSize * 2;
+    auto strips = numTeeth * (2 * halfTooth - 2);
+    if (resolved.boreDiameter <= 0) {
+        return sides + 2 * (strips + numTeeth * 2);
+    }
+    auto boreSegments = static_cast<size_t>(resolved.boreSegments);
+    auto hub = numTeeth * 2 + boreSegments;
+    return sides + 2 * (strips + hub) + boreSegments * 2;
+}
+
+void writeExtrusionStl(const CompactProfile &profile,
+                       const ExtrusionOptions &options,
+                       BufferedWriter &out,
+                       ThreadPool *pool) {
+    auto extrusion = Extrusion{profile, options};
+    auto mesh = triangulateProfile(profile);
+
+    char header[80] = "binary STL from involute-gears";
+    out.write(header, sizeof(header));
+    auto count =
+        static_cast<uint32_t>(extrusionTriangleCount(profile, options));
+    out.write(&count, sizeof(count));
+
+    auto buffer = std::vector<char>{};
+    capTriangles(extrusion, mesh, false, buffer);
+    out.write(buffer.data(), buffer.size());
+
+    // Layers are built in batches, one buffer per layer in the batch
+    auto numLayers = extrusion.options.numLayers;
+    auto batchSize = pool ? pool->size() * 2 : 1;
+    auto buffers = std::vector<std::vector<char>>(batchSize);
+    for (int batch = 0; batch < numLayers;
+         batch += static_cast<int>(batchSize)) {
+        auto num = std::min(batchSize, static_cast<size_t>(numLayers - batch));
+        auto build = [&](size_t i) {
+            layerTriangles(extrusion, batch + static_cast<int>(i), buffers[i]);
+        };
+        if (pool) {
+            pool->parallelFor(num, build, 1);
+        }
+        else {
+            build(0);
+        }
+        for (size_t i = 0; i < num; ++i) {
+            out.write(buffers[i].data(), buffers[i].size());
+        }
+    }
+
+    if (!extrusion.bore.empty()) {
+        boreTriangles(extrusion, buffer);
+        out.write(buffer.data(), buffer.size());
+    }
+
+    capTriangles(extrusion, mesh, true, buffer);
+    out.write(buffer.data(), buffer.size());
+}
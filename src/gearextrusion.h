@@ -0,0 +1,54 @@
+#pragma once
+
+#include "bufferedwriter.h"
+#include "compactprofile.h"
+#include "gearsettings.h"
+#include <cstddef>
+
+class ThreadPool;
+
+// Solid spur or helical gear made by extruding a profile along z
+//
+// The side is divided into layers and every layer is rotated a bit more than
+// the one below it, so that the teeth follow a helix with helixAngle at the
+// pitch circle. The bore is a straight hole through the middle
+struct ExtrusionOptions {
+    // Length along z, in the same unit as the module (usually mm)
+    float height = 10;
+
+    // Degrees, 0 for a spur gear. Positive angles give a right hand helix
+    float helixAngle = 0;
+
+    // 0 for no bore. Must be smaller than the dedendum diameter
+    float boreDiameter = 0;
+
+    // Layers the side is divided into, 0 to pick from the twist so that no
+    // layer turns more than a degree
+    int numLayers = 0;
+
+    // Segments around the bore, 0 to pick from the number of teeth
+    int boreSegments = 0;
+};
+
+// Layers and bore segments that will be used, with the automatic values
+// filled in
+ExtrusionOptions resolveExtrusion(const GearSettings &settings,
+                                  ExtrusionOptions options);
+
+// Number of triangles writeExtrusionStl() writes
+size_t extrusionTriangleCount(const CompactProfile &profile,
+                              const ExtrusionOptions &options);
+
+// Write the extruded gear as binary STL
+//
+// The layers are built in parallel batches on the pool (or on the calling
+// thread without one) and written in order as each batch finishes, so only
+// a batch of layers is ever in memory. Check out.good() for write errors
+//
+// The caps reuse the tooth triangles from triangulateProfile(), so the same
+// limitation applies: the loops of gears whose dedendum circle is outside
+// the base circle fold back at the roots, which the slicer has to repair
+void writeExtrusionStl(const CompactProfile &profile,
+                       const ExtrusionOptions &options,
+                       BufferedWriter &out,
+                       ThreadPool *pool = nullptr);
@@ -0,0 +1,52 @@
+#include "gearmesh.h"
+
+GearMesh triangulateProfile(const std::vector<glm::vec2> &loop,
+                            size_t numTeeth) {
+    auto mesh = GearMesh{};
+    if (!numTeeth || loop.size() < 2 || (loop.size() - 1) % numTeeth) {
+        return mesh;
+    }
+    auto toothSize = (loop.size() - 1) / numTeeth;
+    if (toothSize < 2 || toothSize % 2) {
+        return mesh;
+    }
+
+    auto numPoints = loop.size() - 1;
+    auto center = static_cast<int>(numPoints);
+    mesh.vertices.assign(loop.begin(), loop.end() - 1);
+    mesh.vertices.push_back({0, 0});
+
+    // Point i on the first flank of a tooth is at first + i, and its mirror
+    // image on the second flank at last - i
+    auto n = static_cast<int>(toothSize / 2);
+    auto numTriangles = numTeeth * 2 * n;
+    mesh.indices.reserve(numTriangles * 3);
+
+    auto triangle = [&mesh](int a, int b, int c) {
+        mesh.indices.insert(mesh.indices.end(), {a, b, c});
+    };
+
+    for (size_t tooth = 0; tooth < numTeeth; ++tooth) {
+        auto first = static_cast<int>(tooth * toothSize);
+        auto last = first + 2 * n - 1;
+        auto next = static_cast<int>((tooth + 1) % numTeeth * toothSize);
+
+        // Hub: the base of the tooth and the gap to the next tooth
+        triangle(center, first, last);
+        triangle(center, last, next);
+
+        for (int i = 0; i + 1 < n; ++i) {
+            triangle(first + i, first + i + 1, last - i - 1);
+            triangle(first + i, last - i - 1, last - i);
+        }
+    }
+
+    return mesh;
+}
+
+GearMesh triangulateProfile(const CompactProfile &profile) {
+    auto loop = std::vector<glm::vec2>{};
+    loop.reserve(profile.size());
+    profile.forEachPoint([&loop](glm::vec2 p) { loop.push_back(p); });
+    return triangulateProfile(loop, profile.numTeeth());
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "compactprofile.h"
+#include <glm/glm.hpp>
+#include <vector>
+
+// Triangles that fill a gear profile, in the local coordinates of the profile
+//
+// The loop from generateProfile() is triangulated as a fan from the center
+// over the dedendum points (the hub) and a strip for every tooth, pairing
+// each point on one flank with its mirror image on the other. The pairs are
+// symmetric trapezoids, so the triangles stay inside the outline
+//
+// When the dedendum circle is outside the base circle (about 42 teeth and up
+// at 20 degrees) the loop itself folds back at the tooth roots, and some hub
+// and root triangles overlap inside the hub. The union is still the filled
+// gear, so draw meshes with opaque colors
+struct GearMesh {
+    // The loop points without the closing point, followed by the center
+    std::vector<glm::vec2> vertices;
+
+    // Three per triangle. int since that is what SDL_RenderGeometry takes
+    std::vector<int> indices;
+};
+
+// loop is laid out as generateProfile() writes it, including the closing
+// point. Returns an empty mesh if the size does not fit numTeeth
+GearMesh triangulateProfile(const std::vector<glm::vec2> &loop,
+                            size_t numTeeth);
+
+GearMesh triangulateProfile(const CompactProfile &profile);
@@ -0,0 +1,147 @@
+#include "gearpipeline.h"
+#include <algorithm>
+#include <glm/gtc/constants.hpp>
+
+namespace {
+
+// Settings with the derived fields calculated from the input parameters
+GearSettings inputSettings(const GearSettings &settings) {
+    return GearSettings{.numTeeth = std::max(1, settings.numTeeth),
+                        .module = std::max(1, settings.module),
+                        .preassureAngle = settings.preassureAngle};
+}
+
+} // namespace
+
+GearPipeline::GearPipeline(const GearSettings &settings,
+                           ProfileSampling sampling)
+    : _settings{inputSettings(settings)}
+    , _sampling{sampling}
+    , _circles{_settings} {
+    // Everything is calculated by the constructors
+    _outdated = 0;
+    _lastComputed = ~0u;
+    _model.settings = _settings;
+    _model.pyramid =
+        std::make_shared<const ProfilePyramid>(_settings, sampling);
+    _model.circles = std::make_shared<const ReferenceCircles>(_circles);
+}
+
+void GearPipeline::setSettings(const GearSettings &settings) {
+    auto next = inputSettings(settings);
+    if (next.numTeeth != _settings.numTeeth) {
+        _outdated |= HalfToothStage | PitchCirclesStage | BaseCircleStage;
+    }
+    if (next.module != _settings.module) {
+        _outdated |= HalfToothStage | PitchCirclesStage | BaseCircleStage;
+    }
+    if (next.preassureAngle != _settings.preassureAngle) {
+        _outdated |= HalfToothStage | BaseCircleStage;
+    }
+    _settings = next;
+}
+
+const GearModel &GearPipeline::model() {
+    if (!_outdated) {
+        return _model;
+    }
+
+    // Every level and mesh depends on the half tooth, so the pyramid is
+    // rebuilt as a whole
+    if (_outdated & HalfToothStage) {
+        _outdated |= MeshStage;
+        _model.pyramid =
+            std::make_shared<const ProfilePyramid>(_settings, _sampling);
+    }
+
+    auto full = glm::pi<float>() * 2;
+    if (_outdated & PitchCirclesStage) {
+        arcPoints(_settings.addendumD / 2, 0, full, _circles.addendum);
+        arcPoints(_settings.clearingD / 2, 0, full, _circles.clearing);
+        arcPoints(_settings.dedendumD / 2, 0, full, _circles.dedendum);
+        arcPoints(_settings.pitchD / 2, 0, full, _circles.pitch);
+    }
+    if (_outdated & BaseCircleStage) {
+        arcPoints(_settings.baseD / 2, 0, full, _circles.base);
+    }
+    if (_outdated & (PitchCirclesStage | BaseCircleStage)) {
+        _model.circles = std::make_shared<const ReferenceCircles>(_circles);
+    }
+
+    _model.settings = _settings;
+    _lastComputed = _outdated;
+    _outdated = 0;
+    return _model;
+}
+
+AsyncGearPipeline::AsyncGearPipeline(const GearSettings &settings,
+                                     Clock::duration debounce,
+                                     Clock::duration maxDelay)
+    : _pipeline{settings}
+    , _debounce{debounce}
+    , _maxDelay{maxDelay}
+    , _requested{settings}
+    , _buffer{_pipeline.model()}
+    , _thread{[this] { run(); }} {}
+
+AsyncGearPipeline::~AsyncGearPipeline() {
+    {
+        auto lock = std::unique_lock{_mutex};
+        _isRunning = false;
+    }
+    _cv.notify_all();
+    _thread.join();
+}
+
+void AsyncGearPipeline::request(const GearSettings &settings) {
+    {
+        auto lock = std::unique_lock{_mutex};
+        auto now = Clock::now();
+        if (!_hasRequest) {
+            _firstRequestTime = now;
+        }
+        _lastRequestTime = now;
+        _requested = settings;
+        _hasRequest = true;
+    }
+    _cv.notify_all();
+}
+
+GearSettings AsyncGearPipeline::requested() const {
+    auto lock = std::unique_lock{_mutex};
+    return _requested;
+}
+
+bool AsyncGearPipeline::update() {
+    return _buffer.update();
+}
+
+void AsyncGearPipeline::run() {
+    auto lock = std::unique_lock{_mutex};
+    for (;;) {
+        _cv.wait(lock, [this] { return !_isRunning || _hasRequest; });
+
+        // Wait for the requests to settle, new requests move the deadline
+        for (; _isRunning;) {
+            auto deadline = std::min(_lastRequestTime + _debounce,
+                                     _firstRequestTime + _maxDelay);
+            if (Clock::now() >= deadline) {
+                break;
+            }
+            _cv.wait_until(lock, deadline);
+        }
+        if (!_isRunning) {
+            return;
+        }
+
+        auto settings = _requested;
+        _hasRequest = false;
+        lock.unlock();
+
+        _pipeline.setSettings(settings);
+        _buffer.back() = _pipeline.model();
+        _buffer.publish();
+
+        lock.lock();
+    }
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include "drawlist.h"
+#include "gearsettings.h"
+#include "profilepyramid.h"
+#include "triplebuffer.h"
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+// Everything that is drawn for one gear. The parts are immutable and shared
+// between models, so parts that did not change when the settings were edited
+// are not copied
+struct GearModel {
+    GearSettings settings;
+    // Profiles and meshes for every level of detail
+    std::shared_ptr<const ProfilePyramid> pyramid;
+    std::shared_ptr<const ReferenceCircles> circles;
+};
+
+// Stages of GearPipeline as bits, with the inputs they depend on
+enum GearStage : unsigned {
+    // numTeeth, module and preassureAngle
+    HalfToothStage = 1,
+    // The half teeth
+    MeshStage = 2,
+    // Every reference circle except the base circle, numTeeth and module
+    PitchCirclesStage = 4,
+    // numTeeth, module and preassureAngle
+    BaseCircleStage = 8,
+};
+
+// Builds a GearModel from the input parameters of GearSettings and only
+// recalculates the stages that depend on the parameters that changed
+//
+// Earlier models can still be in use, so a changed profile is built as a new
+// ProfilePyramid instead of updating the shared one in place
+//
+// Changes are lazy: setSettings() only marks stages as outdated and model()
+// recalculates them. Only the input parameters (numTeeth, module and
+// preassureAngle) are used, the other fields are always derived from them
+class GearPipeline {
+public:
+    GearPipeline(const GearSettings &settings, ProfileSampling sampling = {});
+
+    void setSettings(const GearSettings &settings);
+
+    // Stages that are outdated and will be recalculated by model()
+    unsigned outdatedStages() const {
+        return _outdated;
+    }
+
+    const GearModel &model();
+
+    // Stages recalculated by the last call to model() that did any work
+    unsigned lastComputedStages() const {
+        return _lastComputed;
+    }
+
+private:
+    GearSettings _settings;
+    unsigned _outdated = ~0u;
+    unsigned _lastComputed = 0;
+    ProfileSampling _sampling;
+
+    // Working copy that the stages update in place and copy into the model
+    ReferenceCircles _circles;
+
+    GearModel _model;
+};
+
+// GearPipeline on a thread of its own, for editing settings without
+// stalling the render loop
+//
+// Requests are debounced: the model is rebuilt when no new request has
+// arrived for debounce, or at the latest maxDelay after the first pending
+// request so that the model keeps following a slider that is being dragged
+class AsyncGearPipeline {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    AsyncGearPipeline(const GearSettings &settings,
+                      Clock::duration debounce = std::chrono::milliseconds{30},
+                      Clock::duration maxDelay = std::chrono::milliseconds{
+                          120});
+
+    AsyncGearPipeline(const AsyncGearPipeline &) = delete;
+    AsyncGearPipeline &operator=(const AsyncGearPipeline &) = delete;
+
+    ~AsyncGearPipeline();
+
+    // Thread safe. Replaces any request that has not been started yet
+    void request(const GearSettings &settings);
+
+    // The settings of the latest request
+    GearSettings requested() const;
+
+    // Render thread: take the newest finished model. Returns true if it
+    // changed since the last call
+    bool update();
+
+    // Render thread: the model taken by the last update()
+    const GearModel &model() const {
+        return _buffer.front();
+    }
+
+private:
+    void run();
+
+    GearPipeline _pipeline; // Only used by the worker thread
+    Clock::duration _debounce;
+    Clock::duration _maxDelay;
+
+    mutable std::mutex _mutex;
+    std::condition_variable _cv;
+    GearSettings _requested;
+    bool _hasRequest = false;
+    Clock::time_point _firstRequestTime;
+    Clock::time_point _lastRequestTime;
+    bool _isRunning = true;
+
+    TripleBuffer<GearModel> _buffer;
+
+    std::thread _thread;
+};
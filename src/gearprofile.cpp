@@ -0,0 +1,48 @@
+#include "gearprofile.h"
+#include "profilegenerator.h"
+#include <algorithm>
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+using namespace glm;
+
+void GearProfile::computeProfile() {
+    // Only reallocates when the profile grows
+    points.resize(profileSize(settings));
+    generateProfile(settings, points.data(), points.size());
+}
+
+void GearProfile::rotatePoints(float angle) {
+    mat4 location = identity<mat4>();
+    location = rotate(location, angle, {0, 0, 1});
+    for (auto &p : points) {
+        p = location * vec4{p, 0, 1};
+    }
+}
+
+void GearProfile::repeat(int num) {
+    auto tmp = points;
+    for (int i = 1; i < num; ++i) {
+        auto angle = pi<float>() * 2.f * i / num;
+        mat4 location = identity<mat4>();
+        location = rotate(location, angle, {0, 0, 1});
+
+        for (auto p : tmp) {
+            auto pt = location * vec4{p, 0, 1};
+            points.push_back(pt);
+        }
+    }
+}
+
+void GearProfile::mirror() {
+    auto newPoints = decltype(points){};
+    for (auto p : points) {
+        newPoints.push_back({p.x, -p.y});
+    }
+    reverse();
+    points.insert(points.begin(), newPoints.begin(), newPoints.end());
+}
+
+void GearProfile::reverse() {
+    std::reverse(points.begin(), points.end());
+}
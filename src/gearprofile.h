@@ -0,0 +1,23 @@
+#pragma once
+
+#include "gearsettings.h"
+#include <glm/glm.hpp>
+#include <vector>
+
+struct GearProfile {
+    GearSettings settings;
+
+    GearProfile(GearSettings settings)
+        : settings{settings} {
+        computeProfile();
+    }
+
+    void computeProfile();
+
+    void rotatePoints(float angle);
+    void repeat(int num);
+    void mirror();
+    void reverse();
+
+    std::vector<glm::vec2> points;
+};
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "constmath.h"
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+
+// Everything here is constexpr, so settings and profiles of gears that are
+// known up front can be computed at compile time, see standardgears.h
+struct GearSettings {
+    // Input parameters
+    int numTeeth = 10;
+    int module = 1;
+    float preassureAngle = 20; // Degrees 20 is standard for most gears
+
+    // Results. Don't set these unless you know what you're doing
+    float pitchD = module * numTeeth;
+    float addendumD = pitchD + module * 2;
+    float clearingD = pitchD - module * 2;
+    float dedendumD = pitchD - module * 2 * 1.5; // Root angle
+    float baseD =
+        pitchD * constCos(preassureAngle / 180.f * glm::pi<float>());
+    float pitchAngle = glm::pi<float>() * 2. / numTeeth;
+    float gearPitch = pitchAngle * pitchD / 2.f;
+
+    constexpr float thresholdAngle(float d) const {
+        auto angle = profileThresholdAngle(d);
+        auto p = involuteProfile(angle);
+        return constAtan2(p.y, p.x);
+    }
+
+    // Calculate the profile
+    // This is the most important function when calculating gears
+    // Written per component since the glm operators are not constexpr
+    constexpr glm::vec2 involuteProfile(float angle) const {
+        auto r = baseD / 2.f;
+        auto c = constCos(angle);
+        auto s = constSin(angle);
+        return {r * c + r * angle * s, r * -s + r * angle * c};
+    }
+
+    // Note this is only the angle that is used as input to the involuteProfile
+    // function. Use thresholdAngle to get the real angle
+    constexpr float profileThresholdAngle(float d) const {
+        float x = d / 2;
+        float x2 = x * x;
+        float r = baseD / 2;
+        float r2 = r * r;
+        auto inside = x2 / r2 - 1;
+        if (inside <= 0) {
+            return 0;
+        }
+        return constSqrt(inside);
+    }
+};
@@ -0,0 +1,200 @@
+#include "geartrain.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <glm/gtc/constants.hpp>
+#include <unordered_map>
+
+namespace {
+
+// Uniform grid over the gear centers. Cells are as large as the largest
+// gear, so all gears that can mesh with a gear are in the 3x3 surrounding
+// cells
+class SpatialGrid {
+public:
+    SpatialGrid(const std::vector<GearTrain::Gear> &gears, float cellSize)
+        : _cellSize{cellSize} {
+        for (size_t i = 0; i < gears.size(); ++i) {
+            _cells[key(cell(gears[i].pos))].push_back(i);
+        }
+    }
+
+    // Call f(index) for every gear in the cells around pos
+    template <typename F>
+    void forEachNear(glm::vec2 pos, F f) const {
+        auto center = cell(pos);
+        for (int y = -1; y <= 1; ++y) {
+            for (int x = -1; x <= 1; ++x) {
+                auto it =
+                    _cells.find(key({center.first + x, center.second + y}));
+                if (it == _cells.end()) {
+                    continue;
+                }
+                for (auto index : it->second) {
+                    f(index);
+                }
+            }
+        }
+    }
+
+private:
+    std::pair<int32_t, int32_t> cell(glm::vec2 pos) const {
+        return {static_cast<int32_t>(std::floor(pos.x / _cellSize)),
+                static_cast<int32_t>(std::floor(pos.y / _cellSize))};
+    }
+
+    static uint64_t key(std::pair<int32_t, int32_t> cell) {
+        return (static_cast<uint64_t>(static_cast<uint32_t>(cell.first))
+                << 32) |
+               static_cast<uint32_t>(cell.second);
+    }
+
+    float _cellSize;
+    std::unordered_map<uint64_t, std::vector<size_t>> _cells;
+};
+
+} // namespace
+
+float meshingAngle(const GearSettings &a,
+                   float angleA,
+                   const GearSettings &b,
+                   float direction) {
+    // When gear a has the center of a tooth pointing towards b, b has the
+    // center of a gap pointing back
+    auto teethRatio = static_cast<float>(a.numTeeth) / b.numTeeth;
+    return direction + glm::pi<float>() + (direction - angleA) * teethRatio -
+           b.pitchAngle / 2.f;
+}
+
+size_t GearTrain::add(const GearSettings &settings, glm::vec2 pos) {
+    _gears.push_back({settings, pos});
+    return _gears.size() - 1;
+}
+
+void GearTrain::connect(float tolerance) {
+    _links.clear();
+    if (_gears.empty()) {
+        return;
+    }
+
+    float maxDiameter = 0;
+    for (auto &gear : _gears) {
+        maxDiameter = std::max(maxDiameter, gear.settings.pitchD);
+    }
+
+    auto grid = SpatialGrid{_gears, std::max(maxDiameter, 1e-3f)};
+
+    for (size_t i = 0; i < _gears.size(); ++i) {
+        auto &a = _gears[i];
+        grid.forEachNear(a.pos, [&](size_t j) {
+            if (j <= i) {
+                return; // Each pair only once
+            }
+            auto &b = _gears[j];
+            auto distance = glm::distance(a.pos, b.pos);
+            auto module = std::min(a.settings.module, b.settings.module);
+
+            if (distance <= tolerance * module) {
+                _links.push_back({i, j, LinkType::Axle});
+                return;
+            }
+
+            if (a.settings.module != b.settings.module) {
+                return;
+            }
+
+            auto meshDistance = (a.settings.pitchD + b.settings.pitchD) / 2.f;
+            if (std::abs(distance - meshDistance) <= tolerance * module) {
+                _links.push_back({i, j, LinkType::Mesh});
+            }
+        });
+    }
+}
+
+bool GearTrain::solve(size_t driver) {
+    for (auto &gear : _gears) {
+        gear.ratio = 0;
+        gear.phase = 0;
+        gear.isConnected = false;
+    }
+
+    if (driver >= _gears.size()) {
+        return true;
+    }
+
+    // Adjacency list in compressed form, links are stored in both directions
+    auto offsets = std::vector<size_t>(_gears.size() + 1);
+    for (auto &link : _links) {
+        ++offsets[link.a + 1];
+        ++offsets[link.b + 1];
+    }
+    for (size_t i = 1; i < offsets.size(); ++i) {
+        offsets[i] += offsets[i - 1];
+    }
+    auto neighbours = std::vector<std::pair<size_t, LinkType>>(offsets.back());
+    {
+        auto fill = offsets;
+        for (auto &link : _links) {
+            neighbours[fill[link.a]++] = {link.b, link.type};
+            neighbours[fill[link.b]++] = {link.a, link.type};
+        }
+    }
+
+    auto isLocked = false;
+    auto queue = std::vector<size_t>{driver};
+    queue.reserve(_gears.size());
+
+    auto &first = _gears[driver];
+    first.ratio = 1;
+    first.isConnected = true;
+
+    for (size_t q = 0; q < queue.size(); ++q) {
+        auto i = queue[q];
+        auto &a = _gears[i];
+
+        for (auto n = offsets[i]; n < offsets[i + 1]; ++n) {
+            auto [j, type] = neighbours[n];
+            auto &b = _gears[j];
+
+            float ratio = 0;
+            float phase = 0;
+
+            if (type == LinkType::Axle) {
+                ratio = a.ratio;
+                phase = a.phase;
+            }
+            else {
+                // Same as meshingAngle() but split into ratio and phase
+                auto diff = b.pos - a.pos;
+                auto direction = std::atan2(diff.y, diff.x);
+                auto teethRatio = static_cast<float>(a.settings.numTeeth) /
+                                  b.settings.numTeeth;
+                ratio = -teethRatio * a.ratio;
+                phase = direction * (1 + teethRatio) + glm::pi<float>() -
+                        teethRatio * a.phase - b.settings.pitchAngle / 2.f;
+            }
+
+            if (b.isConnected) {
+                // Loops are fine as long as the ratios agree
+                if (std::abs(b.ratio - ratio) > 1e-4f * std::abs(ratio)) {
+                    isLocked = true;
+                }
+                continue;
+            }
+
+            b.ratio = ratio;
+            b.phase = std::remainder(phase, b.settings.pitchAngle);
+            b.isConnected = true;
+            queue.push_back(j);
+        }
+    }
+
+    return !isLocked;
+}
+
+void GearTrain::update(float driverAngle, std::vector<float> &angles) const {
+    angles.resize(_gears.size());
+    for (size_t i = 0; i < _gears.size(); ++i) {
+        angles[i] = _gears[i].ratio * driverAngle + _gears[i].phase;
+    }
+}
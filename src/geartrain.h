@@ -0,0 +1,81 @@
+#pragma once
+
+#include "gearsettings.h"
+#include <cstddef>
+#include <glm/glm.hpp>
+#include <utility>
+#include <vector>
+
+// Angle of gear b when it meshes with gear a that has angle angleA.
+// direction is the angle of the line from the center of a to the center of b.
+// This is the relation GearTrain::solve() uses for meshing gears
+float meshingAngle(const GearSettings &a,
+                   float angleA,
+                   const GearSettings &b,
+                   float direction);
+
+// Kinematics for any number of gears meshing with each other
+//
+// Gears are added with their position. connect() finds the gears that mesh
+// (same module and center distance equal to the sum of the pitch radii) and
+// gears on the same axle, with a spatial grid so that it scales to large
+// trains. solve() then walks the graph from the driving gear and expresses
+// every gear's angle as a linear function of the driver angle,
+//
+//   angle = ratio * driverAngle + phase
+//
+// where the phase makes the teeth line up. After that update() is a single
+// pass over the gears
+class GearTrain {
+public:
+    struct Gear {
+        GearSettings settings;
+        glm::vec2 pos = {};
+
+        // Results from solve()
+        float ratio = 0;
+        float phase = 0;
+        bool isConnected = false;
+    };
+
+    enum class LinkType {
+        Mesh,
+        Axle, // Gears fixed to the same axle, rotating together
+    };
+
+    struct Link {
+        size_t a;
+        size_t b;
+        LinkType type;
+    };
+
+    // Returns the index of the new gear
+    size_t add(const GearSettings &settings, glm::vec2 pos);
+
+    // Find all links. Gears mesh if the center distance is within tolerance
+    // of the sum of the pitch radii, tolerance is relative to the module
+    void connect(float tolerance = .01f);
+
+    // Calculate ratio and phase for every gear reachable from driver. Returns
+    // false if the train is locked, ie a loop of gears that can not turn
+    bool solve(size_t driver = 0);
+
+    // Angle for every gear, unconnected gears stay at angle 0
+    void update(float driverAngle, std::vector<float> &angles) const;
+
+    const std::vector<Gear> &gears() const {
+        return _gears;
+    }
+
+    const std::vector<Link> &links() const {
+        return _links;
+    }
+
+    size_t size() const {
+        return _gears.size();
+    }
+
+private:
+    std::vector<Gear> _gears;
+    std::vector<Link> _links;
+};
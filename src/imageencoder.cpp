@@ -0,0 +1,392 @@
+#include "imageencoder.h"
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+namespace {
+
+// Writes bit fields starting from the least significant bit, as both
+// deflate and GIF's LZW do
+class BitWriter {
+public:
+    explicit BitWriter(std::vector<uint8_t> &out)
+        : _out{out} {}
+
+    void write(uint32_t value, int numBits) {
+        _bits |= static_cast<uint64_t>(value) << _numBits;
+        _numBits += numBits;
+        while (_numBits >= 8) {
+            _out.push_back(static_cast<uint8_t>(_bits));
+            _bits >>= 8;
+            _numBits -= 8;
+        }
+    }
+
+    // Huffman codes are stored from the most significant bit
+    void writeReversed(uint32_t code, int numBits) {
+        auto reversed = uint32_t{0};
+        for (int i = 0; i < numBits; ++i) {
+            reversed = (reversed << 1) | ((code >> i) & 1);
+        }
+        write(reversed, numBits);
+    }
+
+    // Pad to a whole byte
+    void flush() {
+        if (_numBits > 0) {
+            _out.push_back(static_cast<uint8_t>(_bits));
+        }
+        _bits = 0;
+        _numBits = 0;
+    }
+
+private:
+    std::vector<uint8_t> &_out;
+    uint64_t _bits = 0;
+    int _numBits = 0;
+};
+
+void writeBigEndian(std::vector<uint8_t> &out, uint32_t value) {
+    out.push_back(static_cast<uint8_t>(value >> 24));
+    out.push_back(static_cast<uint8_t>(value >> 16));
+    out.push_back(static_cast<uint8_t>(value >> 8));
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+void writeLittleEndian16(std::vector<uint8_t> &out, int value) {
+    out.push_back(static_cast<uint8_t>(value));
+    out.push_back(static_cast<uint8_t>(value >> 8));
+}
+
+uint32_t crc32(const uint8_t *data, size_t size) {
+    static const auto table = [] {
+        auto table = std::array<uint32_t, 256>{};
+        for (uint32_t i = 0; i < 256; ++i) {
+            auto c = i;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+            }
+            table[i] = c;
+        }
+        return table;
+    }();
+
+    auto crc = 0xffffffffu;
+    for (size_t i = 0; i < size; ++i) {
+        crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    }
+    return crc ^ 0xffffffffu;
+}
+
+uint32_t adler32(const std::vector<uint8_t> &data) {
+    uint32_t a = 1;
+    uint32_t b = 0;
+    for (size_t i = 0; i < data.size();) {
+        // Largest block that can not overflow before the modulo
+        auto end = std::min(data.size(), i + 5552);
+        for (; i < end; ++i) {
+            a += data[i];
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+    }
+    return (b << 16) | a;
+}
+
+void writeChunk(std::vector<uint8_t> &out,
+                const char *type,
+                const std::vector<uint8_t> &data) {
+    writeBigEndian(out, static_cast<uint32_t>(data.size()));
+    auto start = out.size();
+    out.insert(out.end(), type, type + 4);
+    out.insert(out.end(), data.begin(), data.end());
+    writeBigEndian(out, crc32(out.data() + start, out.size() - start));
+}
+
+// Literal or length symbol with the fixed Huffman codes of deflate
+void writeFixedSymbol(BitWriter &bits, int symbol) {
+    if (symbol < 144) {
+        bits.writeReversed(0x30 + symbol, 8);
+    }
+    else if (symbol < 256) {
+        bits.writeReversed(0x190 + symbol - 144, 9);
+    }
+    else if (symbol < 280) {
+        bits.writeReversed(symbol - 256, 7);
+    }
+    else {
+        bits.writeReversed(0xc0 + symbol - 280, 8);
+    }
+}
+
+constexpr int maxMatchLength = 258;
+constexpr size_t maxMatchDistance = 32768;
+
+void writeMatch(BitWriter &bits, int length, int distance) {
+    static constexpr uint16_t lengthBase[] = {
+        3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+        31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+    static constexpr uint8_t lengthExtra[] = {
+        0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+        2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+    static constexpr uint16_t distanceBase[] = {
+        1,    2,    3,    4,    5,    7,     9,     13,    17,    25,
+        33,   49,   65,   97,   129,  193,   257,   385,   513,   769,
+        1025, 1537, 2049, 3073, 4097, 6145,  8193,  12289, 16385, 24577};
+    static constexpr uint8_t distanceExtra[] = {
+        0, 0, 0, 0, 1, 1, 2, 2,  3,  3,  4,  4,  5,  5,  6,
+        6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+    auto l = static_cast<int>(
+        std::upper_bound(std::begin(lengthBase), std::end(lengthBase), length) -
+        std::begin(lengthBase) - 1);
+    writeFixedSymbol(bits, 257 + l);
+    bits.write(length - lengthBase[l], lengthExtra[l]);
+
+    auto d = static_cast<int>(std::upper_bound(std::begin(distanceBase),
+                                               std::end(distanceBase),
+                                               distance) -
+                              std::begin(distanceBase) - 1);
+    bits.writeReversed(d, 5);
+    bits.write(distance - distanceBase[d], distanceExtra[d]);
+}
+
+// One fixed Huffman block. Matches are only looked for one pixel back and one
+// row up, which finds the flat areas and the repeated rows
+void deflate(const std::vector<uint8_t> &data,
+             size_t stride,
+             std::vector<uint8_t> &out) {
+    auto bits = BitWriter{out};
+    bits.write(1, 1); // Last block
+    bits.write(1, 2); // Fixed Huffman codes
+
+    size_t distances[] = {4, stride};
+    for (size_t i = 0; i < data.size();) {
+        auto bestLength = 0;
+        auto bestDistance = 0;
+        for (auto distance : distances) {
+            if (distance > i || distance > maxMatchDistance) {
+                continue;
+            }
+            auto length = 0;
+            auto end = std::min(data.size() - i, size_t{maxMatchLength});
+            while (static_cast<size_t>(length) < end &&
+                   data[i + length] == data[i + length - distance]) {
+                ++length;
+            }
+            if (length > bestLength) {
+                bestLength = length;
+                bestDistance = static_cast<int>(distance);
+            }
+        }
+
+        if (bestLength >= 3) {
+            writeMatch(bits, bestLength, bestDistance);
+            i += bestLength;
+        }
+        else {
+            writeFixedSymbol(bits, data[i]);
+            ++i;
+        }
+    }
+
+    writeFixedSymbol(bits, 256); // End of block
+    bits.flush();
+}
+
+// 6x6x6 color cube followed by grays
+constexpr int numCubeColors = 216;
+
+std::array<uint8_t, 768> gifPalette() {
+    auto palette = std::array<uint8_t, 768>{};
+    for (int i = 0; i < numCubeColors; ++i) {
+        palette[i * 3] = static_cast<uint8_t>(i / 36 * 51);
+        palette[i * 3 + 1] = static_cast<uint8_t>(i / 6 % 6 * 51);
+        palette[i * 3 + 2] = static_cast<uint8_t>(i % 6 * 51);
+    }
+    for (int i = numCubeColors; i < 256; ++i) {
+        auto gray = static_cast<uint8_t>((i - numCubeColors + 1) * 255 / 41);
+        palette[i * 3] = palette[i * 3 + 1] = palette[i * 3 + 2] = gray;
+    }
+    return palette;
+}
+
+// Closest palette color for every color with 5 bits per channel
+const std::vector<uint8_t> &paletteLookup() {
+    static const auto lookup = [] {
+        auto palette = gifPalette();
+        auto lookup = std::vector<uint8_t>(32 * 32 * 32);
+        for (int i = 0; i < 32 * 32 * 32; ++i) {
+            int color[] = {(i >> 10) * 8 + 4, (i >> 5 & 31) * 8 + 4,
+                           (i & 31) * 8 + 4};
+            auto best = 0;
+            auto bestDistance = 1 << 30;
+            for (int p = 0; p < 256; ++p) {
+                auto distance = 0;
+                for (int c = 0; c < 3; ++c) {
+                    auto d = color[c] - palette[p * 3 + c];
+                    distance += d * d;
+                }
+                if (distance < bestDistance) {
+                    best = p;
+                    bestDistance = distance;
+                }
+            }
+            lookup[i] = static_cast<uint8_t>(best);
+        }
+        return lookup;
+    }();
+    return lookup;
+}
+
+// Variable code size LZW as used by GIF, with a hash table for the
+// dictionary
+void lzw(const std::vector<uint8_t> &indices, std::vector<uint8_t> &out) {
+    constexpr int minCodeSize = 8;
+    constexpr uint32_t clearCode = 1 << minCodeSize;
+    constexpr uint32_t endCode = clearCode + 1;
+    constexpr uint32_t maxCode = 4095;
+    constexpr size_t tableSize = 1 << 14;
+
+    // Key is the prefix code and the next index, -1 for empty slots
+    auto keys = std::vector<int32_t>(tableSize);
+    auto codes = std::vector<uint16_t>(tableSize);
+
+    auto bits = BitWriter{out};
+    auto codeSize = minCodeSize + 1;
+    auto nextCode = endCode + 1;
+
+    auto reset = [&] {
+        std::fill(keys.begin(), keys.end(), -1);
+        codeSize = minCodeSize + 1;
+        nextCode = endCode + 1;
+    };
+
+    reset();
+    bits.write(clearCode, codeSize);
+
+    if (indices.empty()) {
+        bits.write(endCode, codeSize);
+        bits.flush();
+        return;
+    }
+
+    uint32_t prefix = indices.front();
+    for (size_t i = 1; i < indices.size(); ++i) {
+        auto key = static_cast<int32_t>(prefix << 8 | indices[i]);
+        auto slot = (static_cast<uint32_t>(key) * 2654435761u) >> 18;
+        while (keys[slot] != -1 && keys[slot] != key) {
+            slot = (slot + 1) & (tableSize - 1);
+        }
+        if (keys[slot] == key) {
+            prefix = codes[slot];
+            continue;
+        }
+
+        bits.write(prefix, codeSize);
+        keys[slot] = key;
+        codes[slot] = static_cast<uint16_t>(nextCode);
+        if (nextCode >= (1u << codeSize)) {
+            ++codeSize;
+        }
+        if (nextCode++ == maxCode) {
+            bits.write(clearCode, codeSize);
+            reset();
+        }
+        prefix = indices[i];
+    }
+
+    bits.write(prefix, codeSize);
+    bits.write(endCode, codeSize);
+    bits.flush();
+}
+
+} // namespace
+
+std::vector<uint8_t> encodePng(const Image &image) {
+    auto out =
+        std::vector<uint8_t>{0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+
+    auto header = std::vector<uint8_t>{};
+    writeBigEndian(header, image.width);
+    writeBigEndian(header, image.height);
+    // 8 bits per channel, RGBA, deflate, standard filters, no interlacing
+    header.insert(header.end(), {8, 6, 0, 0, 0});
+    writeChunk(out, "IHDR", header);
+
+    // Every row starts with filter type 0 (none)
+    auto rowSize = static_cast<size_t>(image.width) * 4;
+    auto stride = rowSize + 1;
+    auto raw = std::vector<uint8_t>(stride * image.height);
+    for (int y = 0; y < image.height; ++y) {
+        raw[y * stride] = 0;
+        std::memcpy(raw.data() + y * stride + 1,
+                    image.pixels.data() + y * rowSize,
+                    rowSize);
+    }
+
+    // zlib stream: deflate with a 32 KiB window and no preset dictionary
+    auto compressed = std::vector<uint8_t>{0x78, 0x01};
+    deflate(raw, stride, compressed);
+    writeBigEndian(compressed, adler32(raw));
+    writeChunk(out, "IDAT", compressed);
+
+    writeChunk(out, "IEND", {});
+    return out;
+}
+
+std::vector<uint8_t> gifHeader(int width, int height) {
+    auto out = std::vector<uint8_t>{'G', 'I', 'F', '8', '9', 'a'};
+    writeLittleEndian16(out, width);
+    writeLittleEndian16(out, height);
+    // Global color table of 256 colors with 8 bits per channel
+    out.insert(out.end(), {0xf7, 0, 0});
+    auto palette = gifPalette();
+    out.insert(out.end(), palette.begin(), palette.end());
+
+    // Loop forever
+    const char netscape[] = "NETSCAPE2.0";
+    out.insert(out.end(), {0x21, 0xff, 11});
+    out.insert(out.end(), netscape, netscape + 11);
+    out.insert(out.end(), {3, 1, 0, 0, 0});
+    return out;
+}
+
+std::vector<uint8_t> gifFrame(const Image &image, int delay) {
+    auto &lookup = paletteLookup();
+    auto numPixels = static_cast<size_t>(image.width) * image.height;
+    auto indices = std::vector<uint8_t>(numPixels);
+    for (size_t i = 0; i < numPixels; ++i) {
+        auto p = image.pixels.data() + i * 4;
+        indices[i] = lookup[(p[0] >> 3) << 10 | (p[1] >> 3) << 5 | p[2] >> 3];
+    }
+
+    auto out = std::vector<uint8_t>{};
+
+    // Graphic control extension: keep the frame in place, no transparency
+    out.insert(out.end(), {0x21, 0xf9, 4, 0x04});
+    writeLittleEndian16(out, delay);
+    out.insert(out.end(), {0, 0});
+
+    // Image descriptor for the whole screen, no local color table
+    out.push_back(0x2c);
+    writeLittleEndian16(out, 0);
+    writeLittleEndian16(out, 0);
+    writeLittleEndian16(out, image.width);
+    writeLittleEndian16(out, image.height);
+    out.push_back(0);
+
+    auto data = std::vector<uint8_t>{};
+    lzw(indices, data);
+
+    // Data is split into blocks of at most 255 bytes
+    out.push_back(8);
+    for (size_t i = 0; i < data.size(); i += 255) {
+        auto size = std::min<size_t>(255, data.size() - i);
+        out.push_back(static_cast<uint8_t>(size));
+        out.insert(out.end(), data.begin() + i, data.begin() + i + size);
+    }
+    out.push_back(0);
+    return out;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "rasterizer.h"
+#include <cstdint>
+#include <vector>
+
+// Image file encoders without any dependencies. Every frame is encoded on
+// its own into a byte buffer, so frames can be encoded in parallel and
+// written in order afterwards
+
+// Complete PNG file. The pixels are compressed with fixed Huffman codes and
+// matches against the previous pixel and the pixel above, which is simple
+// but works well for line drawings on a flat background
+std::vector<uint8_t> encodePng(const Image &image);
+
+// Animated GIF, written as gifHeader(), then gifFrame() for every frame and
+// finally gifTrailer. Colors are mapped to a fixed palette of a 6x6x6 color
+// cube and 40 extra grays, so no palette has to be shared between frames
+std::vector<uint8_t> gifHeader(int width, int height);
+
+// delay is the time the frame is shown in hundredths of a second
+std::vector<uint8_t> gifFrame(const Image &image, int delay);
+
+constexpr uint8_t gifTrailer = 0x3b;
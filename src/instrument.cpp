@@ -0,0 +1,136 @@
+#include "instrument.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <ostream>
+#include <thread>
+
+namespace {
+
+// Small number identifying the calling thread in the trace
+uint32_t threadNumber() {
+    static auto mutex = std::mutex{};
+    static auto threads = std::vector<std::thread::id>{};
+
+    thread_local uint32_t number = [] {
+        auto lock = std::unique_lock{mutex};
+        threads.push_back(std::this_thread::get_id());
+        return static_cast<uint32_t>(threads.size());
+    }();
+    return number;
+}
+
+double percentile(std::vector<float> &values, double amount) {
+    if (values.empty()) {
+        return 0;
+    }
+    auto index = static_cast<size_t>(amount * (values.size() - 1) + .5);
+    std::nth_element(values.begin(), values.begin() + index, values.end());
+    return values.at(index);
+}
+
+} // namespace
+
+Profiler::Profiler(bool isTracing)
+    : _isTracing{isTracing}
+    , _epoch{ClockT::now()} {
+    if (_isTracing) {
+        _events.reserve(4096);
+    }
+}
+
+void Profiler::record(const char *name,
+                      ClockT::time_point start,
+                      ClockT::time_point end) {
+    auto duration = std::chrono::duration<float, std::milli>(end - start);
+
+    auto lock = std::unique_lock{_mutex};
+
+    // Few stages, and names are mostly the same pointers, so a linear search
+    // is fast enough
+    auto it = std::find_if(_stages.begin(), _stages.end(), [name](auto &s) {
+        return s.name == name || std::strcmp(s.name, name) == 0;
+    });
+    if (it == _stages.end()) {
+        _stages.push_back({name, std::vector<float>(historySize)});
+        it = _stages.end() - 1;
+    }
+
+    it->durations[it->next] = duration.count();
+    it->next = (it->next + 1) % historySize;
+    it->count = std::min(it->count + 1, historySize);
+
+    if (_isTracing && _events.size() < maxTraceEvents) {
+        using std::chrono::duration_cast;
+        using std::chrono::microseconds;
+        _events.push_back({
+            name,
+            duration_cast<microseconds>(start - _epoch).count(),
+            duration_cast<microseconds>(end - start).count(),
+            threadNumber(),
+        });
+    }
+}
+
+std::vector<Profiler::StageStats> Profiler::stats() const {
+    auto lock = std::unique_lock{_mutex};
+
+    auto result = std::vector<StageStats>{};
+    auto values = std::vector<float>{};
+    for (auto &stage : _stages) {
+        values.assign(stage.durations.begin(),
+                      stage.durations.begin() + stage.count);
+        auto stats = StageStats{};
+        stats.name = stage.name;
+        stats.p50 = percentile(values, .5);
+        stats.p99 = percentile(values, .99);
+        stats.max = values.empty()
+                        ? 0
+                        : *std::max_element(values.begin(), values.end());
+        result.push_back(stats);
+    }
+    return result;
+}
+
+void Profiler::printSummary(std::ostream &out) const {
+    auto isFirst = true;
+    char line[128];
+    for (auto &stage : stats()) {
+        std::snprintf(line,
+                      sizeof(line),
+                      "%s%s p50 %.2f ms p99 %.2f ms",
+                      isFirst ? "" : " | ",
+                      stage.name,
+                      stage.p50,
+                      stage.p99);
+        out << line;
+        isFirst = false;
+    }
+    out << "\n";
+}
+
+bool Profiler::writeChromeTrace(const std::string &path) const {
+    auto file = std::fopen(path.c_str(), "w");
+    if (!file) {
+        return false;
+    }
+
+    auto lock = std::unique_lock{_mutex};
+
+    std::fprintf(file, "{\"traceEvents\": [\n");
+    for (size_t i = 0; i < _events.size(); ++i) {
+        auto &event = _events.at(i);
+        std::fprintf(file,
+                     "{\"name\": \"%s\", \"ph\": \"X\", \"ts\": %lld, "
+                     "\"dur\": %lld, \"pid\": 1, \"tid\": %u}%s\n",
+                     event.name,
+                     static_cast<long long>(event.start),
+                     static_cast<long long>(event.duration),
+                     event.thread,
+                     i + 1 < _events.size() ? "," : "");
+    }
+    std::fprintf(file, "], \"displayTimeUnit\": \"ms\"}\n");
+
+    return std::fclose(file) == 0;
+}
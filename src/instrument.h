@@ -0,0 +1,99 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Lightweight timing of named stages, for example the parts of a render loop
+//
+// Durations are kept for the last frames so that percentiles can be printed
+// while running. When tracing is enabled every timed scope is also recorded as
+// an event that can be written in Chrome's trace event format and opened in
+// chrome://tracing or https://ui.perfetto.dev
+class Profiler {
+public:
+    using ClockT = std::chrono::steady_clock;
+
+    // Number of frames that statistics are calculated over
+    static constexpr size_t historySize = 512;
+
+    // Recording stops after this many trace events, to keep memory bounded
+    static constexpr size_t maxTraceEvents = 1 << 20;
+
+    explicit Profiler(bool isTracing = false);
+
+    // Time a scope and add the duration to a stage. name must be a string
+    // that outlives the profiler, like a string literal
+    class Scope {
+    public:
+        Scope(Profiler &profiler, const char *name)
+            : _profiler{profiler}
+            , _name{name}
+            , _start{ClockT::now()} {}
+
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+
+        ~Scope() {
+            _profiler.record(_name, _start, ClockT::now());
+        }
+
+    private:
+        Profiler &_profiler;
+        const char *_name;
+        ClockT::time_point _start;
+    };
+
+    // Record a finished stage manually
+    void record(const char *name,
+                ClockT::time_point start,
+                ClockT::time_point end);
+
+    struct StageStats {
+        const char *name = nullptr;
+        double p50 = 0; // Milliseconds
+        double p99 = 0;
+        double max = 0;
+    };
+
+    // Percentiles over the last historySize durations of each stage, in the
+    // order the stages were first recorded
+    std::vector<StageStats> stats() const;
+
+    // One line summary like "frame p50 16.1 ms p99 17.0 ms | draw ..."
+    void printSummary(std::ostream &out) const;
+
+    bool isTracing() const {
+        return _isTracing;
+    }
+
+    // Write all recorded events as Chrome trace event json. Returns false if
+    // the file could not be written
+    bool writeChromeTrace(const std::string &path) const;
+
+private:
+    struct Stage {
+        const char *name;
+        std::vector<float> durations; // Ring buffer of milliseconds
+        size_t next = 0;
+        size_t count = 0;
+    };
+
+    struct Event {
+        const char *name;
+        int64_t start; // Microseconds since the profiler was created
+        int64_t duration;
+        uint32_t thread;
+    };
+
+    bool _isTracing;
+    ClockT::time_point _epoch;
+
+    mutable std::mutex _mutex;
+    std::vector<Stage> _stages;
+    std::vector<Event> _events;
+};
@@ -0,0 +1,357 @@
+#include "interference.h"
+#include "geartrain.h"
+#include "threadpool.h"
+#include <algorithm>
+#include <cmath>
+#include <glm/gtc/constants.hpp>
+
+namespace {
+
+constexpr uint32_t leafSize = 4;
+
+struct Transform {
+    float c;
+    float s;
+    glm::vec2 offset;
+
+    glm::vec2 operator()(glm::vec2 p) const {
+        return glm::vec2{c * p.x - s * p.y, s * p.x + c * p.y} + offset;
+    }
+};
+
+// Transform from the local coordinates of b to the local coordinates of a
+Transform relative(Placement a, Placement b) {
+    auto angle = b.angle - a.angle;
+    auto d = b.pos - a.pos;
+    auto c = std::cos(-a.angle);
+    auto s = std::sin(-a.angle);
+    return {
+        std::cos(angle),
+        std::sin(angle),
+        {c * d.x - s * d.y, s * d.x + c * d.y},
+    };
+}
+
+Transform inverse(const Transform &t) {
+    // Rotate back, then undo the offset
+    auto o = t.offset;
+    return {t.c, -t.s, {-(t.c * o.x + t.s * o.y), -(-t.s * o.x + t.c * o.y)}};
+}
+
+struct Box {
+    glm::vec2 min;
+    glm::vec2 max;
+};
+
+Box transformBox(const SegmentBvh::Node &node, const Transform &t) {
+    auto center = t((node.min + node.max) / 2.f);
+    auto half = (node.max - node.min) / 2.f;
+    auto ac = std::abs(t.c);
+    auto as = std::abs(t.s);
+    auto extent =
+        glm::vec2{ac * half.x + as * half.y, as * half.x + ac * half.y};
+    return {center - extent, center + extent};
+}
+
+float boxDistance(const SegmentBvh::Node &a, const Box &b) {
+    auto dx = std::max({0.f, a.min.x - b.max.x, b.min.x - a.max.x});
+    auto dy = std::max({0.f, a.min.y - b.max.y, b.min.y - a.max.y});
+    return std::sqrt(dx * dx + dy * dy);
+}
+
+float cross(glm::vec2 a, glm::vec2 b) {
+    return a.x * b.y - a.y * b.x;
+}
+
+bool segmentsIntersect(glm::vec2 p1, glm::vec2 p2, glm::vec2 q1, glm::vec2 q2) {
+    auto d1 = cross(p2 - p1, q1 - p1);
+    auto d2 = cross(p2 - p1, q2 - p1);
+    auto d3 = cross(q2 - q1, p1 - q1);
+    auto d4 = cross(q2 - q1, p2 - q1);
+    return ((d1 > 0) != (d2 > 0)) && ((d3 > 0) != (d4 > 0)) && d1 != d2 &&
+           d3 != d4;
+}
+
+float pointSegmentDistance(glm::vec2 p, glm::vec2 a, glm::vec2 b) {
+    auto ab = b - a;
+    auto lengthSq = glm::dot(ab, ab);
+    auto t = lengthSq > 0 ? glm::clamp(glm::dot(p - a, ab) / lengthSq, 0.f, 1.f)
+                          : 0.f;
+    return glm::distance(p, a + ab * t);
+}
+
+float segmentDistance(glm::vec2 p1, glm::vec2 p2, glm::vec2 q1, glm::vec2 q2) {
+    if (segmentsIntersect(p1, p2, q1, q2)) {
+        return 0;
+    }
+    return std::min({pointSegmentDistance(p1, q1, q2),
+                     pointSegmentDistance(p2, q1, q2),
+                     pointSegmentDistance(q1, p1, p2),
+                     pointSegmentDistance(q2, p1, p2)});
+}
+
+} // namespace
+
+SegmentBvh::SegmentBvh(std::vector<glm::vec2> points)
+    : _points{std::move(points)} {
+    if (_points.size() < 2) {
+        _points.resize(2);
+    }
+    _nodes.reserve(2 * (_points.size() / leafSize + 1));
+    build(0, static_cast<uint32_t>(_points.size() - 1));
+}
+
+uint32_t SegmentBvh::build(uint32_t first, uint32_t last) {
+    auto index = static_cast<uint32_t>(_nodes.size());
+    _nodes.push_back({});
+
+    auto min = _points[first];
+    auto max = min;
+    for (auto i = first; i <= last; ++i) {
+        min = glm::min(min, _points[i]);
+        max = glm::max(max, _points[i]);
+    }
+
+    if (last - first <= leafSize) {
+        _nodes[index] = {min, max, first, last, true};
+        return index;
+    }
+
+    auto middle = first + (last - first) / 2;
+    auto left = build(first, middle);
+    auto right = build(middle, last);
+    _nodes[index] = {min, max, left, right, false};
+    return index;
+}
+
+bool SegmentBvh::contains(glm::vec2 p) const {
+    // Count crossings of a ray going in +x
+    bool isInside = false;
+    uint32_t stack[64];
+    int size = 0;
+    stack[size++] = 0;
+    while (size) {
+        auto &node = _nodes[stack[--size]];
+        if (p.y < node.min.y || p.y > node.max.y || p.x > node.max.x) {
+            continue;
+        }
+        if (!node.isLeaf) {
+            stack[size++] = node.first;
+            stack[size++] = node.second;
+            continue;
+        }
+        for (auto i = node.first; i < node.second; ++i) {
+            auto a = _points[i];
+            auto b = _points[i + 1];
+            if ((a.y > p.y) != (b.y > p.y)) {
+                auto x = a.x + (p.y - a.y) / (b.y - a.y) * (b.x - a.x);
+                if (x > p.x) {
+                    isInside = !isInside;
+                }
+            }
+        }
+    }
+    return isInside;
+}
+
+Clearance clearance(const SegmentBvh &a,
+                    Placement placementA,
+                    const SegmentBvh &b,
+                    Placement placementB,
+                    float maxDistance) {
+    auto toA = relative(placementA, placementB);
+    auto &nodesA = a.nodes();
+    auto &nodesB = b.nodes();
+    auto &pointsA = a.points();
+    auto &pointsB = b.points();
+
+    auto best = maxDistance;
+
+    // Tree depth is logarithmic in the number of segments, the stack only
+    // grows by one pair per level
+    std::pair<uint32_t, uint32_t> stack[128];
+    int size = 0;
+    stack[size++] = {0, 0};
+
+    while (size && best > 0) {
+        auto [ia, ib] = stack[--size];
+        auto &nodeA = nodesA[ia];
+        auto &nodeB = nodesB[ib];
+        auto boxB = transformBox(nodeB, toA);
+        if (boxDistance(nodeA, boxB) >= best) {
+            continue;
+        }
+
+        if (nodeA.isLeaf && nodeB.isLeaf) {
+            for (auto j = nodeB.first; j < nodeB.second; ++j) {
+                auto q1 = toA(pointsB[j]);
+                auto q2 = toA(pointsB[j + 1]);
+                for (auto i = nodeA.first; i < nodeA.second; ++i) {
+                    best = std::min(
+                        best,
+                        segmentDistance(pointsA[i], pointsA[i + 1], q1, q2));
+                }
+            }
+            continue;
+        }
+
+        // Split the larger node
+        auto sizeA = nodeA.max - nodeA.min;
+        auto sizeB = nodeB.max - nodeB.min;
+        if (nodeB.isLeaf ||
+            (!nodeA.isLeaf && sizeA.x + sizeA.y >= sizeB.x + sizeB.y)) {
+            stack[size++] = {nodeA.first, ib};
+            stack[size++] = {nodeA.second, ib};
+        }
+        else {
+            stack[size++] = {ia, nodeB.first};
+            stack[size++] = {ia, nodeB.second};
+        }
+    }
+
+    auto result = Clearance{};
+    if (best <= 0) {
+        result.distance = 0;
+        result.isColliding = true;
+        return result;
+    }
+
+    // No crossing edges, but one loop could still be inside the other
+    if (a.contains(toA(pointsB.front())) ||
+        b.contains(inverse(toA)(pointsA.front()))) {
+        result.distance = 0;
+        result.isColliding = true;
+        return result;
+    }
+
+    result.distance = best < maxDistance
+                          ? best
+                          : std::numeric_limits<float>::infinity();
+    return result;
+}
+
+Contacts countContacts(const SegmentBvh &a,
+                       Placement placementA,
+                       const SegmentBvh &b,
+                       Placement placementB,
+                       float distance,
+                       size_t segmentsPerTooth) {
+    auto toA = relative(placementA, placementB);
+    auto &nodesA = a.nodes();
+    auto &nodesB = b.nodes();
+    auto &pointsA = a.points();
+    auto &pointsB = b.points();
+
+    // Only a few flanks can touch at the same time. Flanks are numbered
+    // twice the tooth plus one for the second half of the tooth
+    constexpr int maxContacts = 32;
+    size_t flanks[maxContacts];
+    int numContacts = 0;
+
+    auto addFlank = [&](size_t segment) {
+        auto flank = segment * 2 / segmentsPerTooth;
+        for (int i = 0; i < numContacts; ++i) {
+            if (flanks[i] == flank) {
+                return;
+            }
+        }
+        if (numContacts < maxContacts) {
+            flanks[numContacts++] = flank;
+        }
+    };
+
+    std::pair<uint32_t, uint32_t> stack[128];
+    int size = 0;
+    stack[size++] = {0, 0};
+
+    while (size) {
+        auto [ia, ib] = stack[--size];
+        auto &nodeA = nodesA[ia];
+        auto &nodeB = nodesB[ib];
+        if (boxDistance(nodeA, transformBox(nodeB, toA)) >= distance) {
+            continue;
+        }
+
+        if (nodeA.isLeaf && nodeB.isLeaf) {
+            for (auto j = nodeB.first; j < nodeB.second; ++j) {
+                auto q1 = toA(pointsB[j]);
+                auto q2 = toA(pointsB[j + 1]);
+                for (auto i = nodeA.first; i < nodeA.second; ++i) {
+                    if (segmentDistance(pointsA[i], pointsA[i + 1], q1, q2) <
+                        distance) {
+                        addFlank(j);
+                        break;
+                    }
+                }
+            }
+            continue;
+        }
+
+        auto sizeA = nodeA.max - nodeA.min;
+        auto sizeB = nodeB.max - nodeB.min;
+        if (nodeB.isLeaf ||
+            (!nodeA.isLeaf && sizeA.x + sizeA.y >= sizeB.x + sizeB.y)) {
+            stack[size++] = {nodeA.first, ib};
+            stack[size++] = {nodeA.second, ib};
+        }
+        else {
+            stack[size++] = {ia, nodeB.first};
+            stack[size++] = {ia, nodeB.second};
+        }
+    }
+
+    auto contacts = Contacts{};
+    for (int i = 0; i < numContacts; ++i) {
+        if (flanks[i] % 2) {
+            ++contacts.positive;
+        }
+        else {
+            ++contacts.negative;
+        }
+    }
+    return contacts;
+}
+
+MeshSweep sweepMesh(const GearSettings &a,
+                    const GearSettings &b,
+                    float centerDistance,
+                    int numSteps,
+                    ThreadPool &pool,
+                    ProfileSampling sampling) {
+    auto makeBvh = [sampling](const GearSettings &settings) {
+        auto points = std::vector<glm::vec2>(profileSize(settings, sampling));
+        generateProfile(settings, points.data(), points.size(), sampling);
+        return SegmentBvh{std::move(points)};
+    };
+
+    auto bvhA = makeBvh(a);
+    auto bvhB = makeBvh(b);
+
+    auto sweep = MeshSweep{};
+    numSteps = std::max(numSteps, 1);
+    sweep.angles.resize(numSteps);
+    sweep.clearances.resize(numSteps);
+
+    pool.parallelFor(numSteps, [&](size_t i) {
+        auto angle = a.pitchAngle * static_cast<float>(i) / numSteps;
+        sweep.angles[i] = angle;
+        sweep.clearances[i] =
+            clearance(bvhA,
+                      {{0, 0}, angle},
+                      bvhB,
+                      {{centerDistance, 0}, meshingAngle(a, angle, b, 0)});
+    });
+
+    for (size_t i = 0; i < sweep.clearances.size(); ++i) {
+        auto &c = sweep.clearances[i];
+        if (c.distance < sweep.minClearance) {
+            sweep.minClearance = c.distance;
+            sweep.minClearanceAngle = sweep.angles[i];
+        }
+        if (c.isColliding) {
+            sweep.collisionAngles.push_back(sweep.angles[i]);
+        }
+    }
+
+    return sweep;
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "gearsettings.h"
+#include "profilegenerator.h"
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <limits>
+#include <vector>
+
+class ThreadPool;
+
+// Position and rotation of a profile
+struct Placement {
+    glm::vec2 pos = {};
+    float angle = 0;
+};
+
+// Bounding volume hierarchy over the segments of a closed loop
+//
+// Consecutive segments of a gear profile are close to each other, so the
+// tree is built by splitting the loop into halves in order, which gives
+// nodes that each cover a range of teeth, then part of a tooth and so on
+class SegmentBvh {
+public:
+    // points is a closed loop, like GearProfile::points
+    explicit SegmentBvh(std::vector<glm::vec2> points);
+
+    struct Node {
+        glm::vec2 min;
+        glm::vec2 max;
+        // Children for inner nodes, segment range for leaves
+        uint32_t first;
+        uint32_t second;
+        bool isLeaf;
+    };
+
+    const std::vector<glm::vec2> &points() const {
+        return _points;
+    }
+
+    const std::vector<Node> &nodes() const {
+        return _nodes;
+    }
+
+    // Is p inside the loop (in the local coordinates of the loop)
+    bool contains(glm::vec2 p) const;
+
+private:
+    uint32_t build(uint32_t first, uint32_t last);
+
+    std::vector<glm::vec2> _points;
+    std::vector<Node> _nodes;
+};
+
+struct Clearance {
+    // Smallest distance between the loops, 0 when they intersect
+    float distance = std::numeric_limits<float>::infinity();
+    bool isColliding = false;
+};
+
+// Smallest distance between two placed loops, and if they overlap. Distances
+// larger than maxDistance are not searched for and reported as infinity
+Clearance clearance(const SegmentBvh &a,
+                    Placement placementA,
+                    const SegmentBvh &b,
+                    Placement placementB,
+                    float maxDistance = std::numeric_limits<float>::infinity());
+
+struct Contacts {
+    // Teeth of b touching a with the flank that faces the positive (counter
+    // clockwise) direction, and with the flank that faces the negative
+    // direction
+    int positive = 0;
+    int negative = 0;
+};
+
+// Count the teeth of b that are closer than distance to a. segmentsPerTooth
+// is the number of loop segments for each tooth of b, which is
+// 2 * halfToothSize() for generated profiles, where the first half of every
+// tooth is the flank facing the negative direction
+Contacts countContacts(const SegmentBvh &a,
+                       Placement placementA,
+                       const SegmentBvh &b,
+                       Placement placementB,
+                       float distance,
+                       size_t segmentsPerTooth);
+
+struct MeshSweep {
+    // Angle of the first gear for each step, over one pitch
+    std::vector<float> angles;
+    std::vector<Clearance> clearances;
+
+    float minClearance = std::numeric_limits<float>::infinity();
+    float minClearanceAngle = 0;
+
+    // Angles of the first gear where the profiles overlap
+    std::vector<float> collisionAngles;
+};
+
+// Place gear a at origin and gear b at (centerDistance, 0), rotate a through
+// one pitch in numSteps steps with b following as if meshing, and check the
+// clearance at every step. The steps are spread over the pool
+MeshSweep sweepMesh(const GearSettings &a,
+                    const GearSettings &b,
+                    float centerDistance,
+                    int numSteps,
+                    ThreadPool &pool,
+                    ProfileSampling sampling = {});
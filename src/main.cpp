@@ -1,232 +1,299 @@
+#include "compactprofile.h"
+#include "drawlist.h"
+#include "gearmesh.h"
+#include "gearpipeline.h"
+#include "geartrain.h"
+#include "instrument.h"
+#include "simulation.h"
 #include "sdlpp/events.hpp"
 #include "sdlpp/render.hpp"
 #include "sdlpp/window.hpp"
-#include <functional>
 #include <glm/glm.hpp>
-#include <glm/gtc/matrix_inverse.hpp>
-#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <cstdio>
 #include <iostream>
+#include <memory>
+#include <optional>
 #include <thread>
 
+#ifdef __EMSCRIPTEN__
+#include <emscripten.h>
+#endif
+
 using namespace std::literals;
 using namespace glm;
 
-using FuncT = std::function<void(glm::vec2, glm::vec2)>;
-
-void drawLine(sdl::RendererView view, glm::vec2 p1, glm::vec2 p2) {
+// Pan and zoom of the view. The middle of the screen shows center, and one
+// unit (the module) is scale pixels
+struct Camera {
+    glm::vec2 center = {40, 30};
     float scale = 10;
-    view.drawLine(p1.x * scale, p1.y * scale, p2.x * scale, p2.y * scale);
-}
-
-void drawArc(FuncT f,
-             glm::vec2 center,
-             float r,
-             float start = 0,
-             float end = pi<float>() * 2) {
+    glm::vec2 screenSize = {800, 600};
 
-    auto step = 1. / r;
-
-    for (float angle = start; angle <= end; angle += step) {
-        auto p1 = center + glm::vec2{sin(angle), cos(angle)} * r;
-        auto p2 = center + glm::vec2{sin(angle + step), cos(angle + step)} * r;
-
-        f(p1, p2);
+    glm::vec2 toWorld(glm::vec2 screen) const {
+        return center + (screen - screenSize / 2.f) / scale;
     }
-}
 
-void drawArc(sdl::RendererView view,
-             glm::vec2 center,
-             float r,
-             float start = 0,
-             float end = pi<float>() * 2) {
-    drawArc([view](auto p1, auto p2) { drawLine(view, p1, p2); },
-            center,
-            r,
-            start,
-            end);
-}
-
-struct GearSettings {
-    // Input parameters
-    int numTeeth = 10;
-    int module = 1;
-    float preassureAngle = 20; // Degrees 20 is standard for most gears
-
-    // Results. Don't set these unless you know what you're doing
-    float pitchD = module * numTeeth;
-    float addendumD = pitchD + module * 2;
-    float clearingD = pitchD - module * 2;
-    float dedendumD = pitchD - module * 2 * 1.5; // Root angle
-    float baseD = pitchD * std::cos(preassureAngle / 180.f * pi<float>());
-    float pitchAngle = pi<float>() * 2. / numTeeth;
-    float gearPitch = pitchAngle * pitchD / 2.f;
-
-    float thresholdAngle(float d) {
-        auto angle = profileThresholdAngle(d);
-        auto p = involuteProfile(angle);
-        return std::atan2(p.y, p.x);
+    // The transform functions in drawlist.h calculate (p + pos) * scale, so
+    // this is the pos that puts world position pos on the screen
+    glm::vec2 offset(glm::vec2 pos) const {
+        return pos - center + screenSize / 2.f / scale;
     }
 
-    // Calculate the profile
-    // This is the most important function when calculating gears
-    glm::vec2 involuteProfile(float angle) {
-        auto r = baseD / 2.f;
-        return r *vec2{std::cos(angle), -std::sin(angle)} +
-               r * angle *vec2{std::sin(angle), std::cos(angle)};
+    glm::vec2 viewMin() const {
+        return toWorld({0, 0});
     }
 
-    // Note this is only the angle that is used as input to the involuteProfile
-    // function. Use thresholdAngle to get the real angle
-    float profileThresholdAngle(float d) const {
-        float x = d / 2;
-        float x2 = x * x;
-        float r = baseD / 2;
-        float r2 = r * r;
-        auto inside = x2 / r2 - 1;
-        if (inside <= 0) {
-            return 0;
-        }
-        return std::sqrt(inside);
+    glm::vec2 viewMax() const {
+        return toWorld(screenSize);
     }
-};
 
-struct GearProfile {
-    GearSettings settings;
-
-    GearProfile(GearSettings settings)
-        : settings{settings} {
-        computeProfile();
+    // Zoom by factor and keep the point under the mouse in place
+    void zoom(float factor, glm::vec2 screen) {
+        auto p = toWorld(screen);
+        scale = std::clamp(scale * factor, .01f, 10000.f);
+        center = p - (screen - screenSize / 2.f) / scale;
     }
 
-    void computeProfile() {
-        points.clear();
-        glm::vec2 v = {};
-        auto correctionAngle = 0;
+    // Show everything from min to max with a small margin
+    void fit(glm::vec2 min, glm::vec2 max) {
+        auto size = max - min;
+        center = (min + max) / 2.f;
+        scale = .9f * std::min(screenSize.x / size.x, screenSize.y / size.y);
+    }
+};
 
-        float l = 0;
+void drawLine(sdl::RendererView view,
+              const Camera &camera,
+              glm::vec2 p1,
+              glm::vec2 p2) {
+    p1 = camera.offset(p1) * camera.scale;
+    p2 = camera.offset(p2) * camera.scale;
+    view.drawLine(p1.x, p1.y, p2.x, p2.y);
+}
 
-        auto from = settings.thresholdAngle(settings.clearingD);
-        auto to = settings.profileThresholdAngle(settings.addendumD);
+// Draw a polyline that is already in screen coordinates with a single call
+void drawLines(sdl::RendererView view, const std::vector<glm::vec2> &points) {
+    static_assert(sizeof(SDL_FPoint) == sizeof(glm::vec2));
+    SDL_RenderDrawLinesF(view.get(),
+                         reinterpret_cast<const SDL_FPoint *>(points.data()),
+                         static_cast<int>(points.size()));
+}
 
-        int steps = 20;
+// Draw a local space polyline (like ReferenceCircles) centered at pos
+void drawLines(sdl::RendererView view,
+               const Camera &camera,
+               const std::vector<glm::vec2> &points,
+               glm::vec2 pos) {
+    static auto buffer = std::vector<glm::vec2>{};
+    transformPoints(points, camera.offset(pos), camera.scale, buffer);
+    drawLines(view, buffer);
+}
 
-        for (auto i = 0; i <= steps; ++i) {
-            auto amount = static_cast<float>(i) / steps;
-            auto angle = from + (to - from) * amount;
+// Draw a filled mesh that is already in screen coordinates with a single call
+void drawMesh(sdl::RendererView view,
+              const std::vector<MeshVertex> &vertices,
+              const std::vector<int> &indices) {
+    static_assert(sizeof(SDL_Vertex) == sizeof(MeshVertex));
+    SDL_RenderGeometry(view.get(),
+                       nullptr,
+                       reinterpret_cast<const SDL_Vertex *>(vertices.data()),
+                       static_cast<int>(vertices.size()),
+                       indices.data(),
+                       static_cast<int>(indices.size()));
+}
 
-            v = settings.involuteProfile(angle);
+struct GearView {
+    // Shared by all views of the same gear, replaced when the gear is edited
+    std::shared_ptr<const ProfilePyramid> pyramid;
+    glm::vec2 pos = {};
+    float angle = 0;
 
-            points.push_back(v);
+    // Only the teeth that are on screen are drawn, from the level of detail
+    // that matches the zoom
+    void draw(sdl::RendererView view, const Camera &camera) {
+        auto &profile = pyramid->level(camera.scale).profile;
+        auto teeth = visibleTeeth(profile,
+                                  pos,
+                                  angle,
+                                  camera.viewMin(),
+                                  camera.viewMax());
+        if (!teeth.count) {
+            return;
         }
-
-        auto last = normalize(points.front()) * settings.dedendumD / 2.f;
-        points.insert(points.begin(), last);
-
-        rotatePoints(-settings.thresholdAngle(settings.pitchD) +
-                     settings.pitchAngle / 2.f / 2.f);
-        mirror();
-        repeat(settings.numTeeth);
-        points.push_back(points.front()); // Close loop
+        transformTeeth(
+            profile, teeth, camera.offset(pos), angle, camera.scale, buffer);
+        drawLines(view, buffer);
     }
 
-    void rotatePoints(float angle) {
-        mat4 location = identity<mat4>();
-        location = rotate(location, angle, {0, 0, 1});
-        for (auto &p : points) {
-            p = location *vec4{p, 0, 1};
+    void drawFilled(sdl::RendererView view, const Camera &camera, Color color) {
+        auto &level = pyramid->level(camera.scale);
+        auto teeth = visibleTeeth(level.profile,
+                                  pos,
+                                  angle,
+                                  camera.viewMin(),
+                                  camera.viewMax());
+        if (!teeth.count) {
+            return;
         }
+        transformMeshTeeth(level.mesh,
+                           level.profile.numTeeth(),
+                           teeth,
+                           camera.offset(pos),
+                           angle,
+                           camera.scale,
+                           color,
+                           vertices,
+                           indices);
+        drawMesh(view, vertices, indices);
     }
 
-    void repeat(int num) {
-        auto tmp = points;
-        for (int i = 1; i < num; ++i) {
-            auto angle = pi<float>() * 2.f * i / num;
-            mat4 location = identity<mat4>();
-            location = rotate(location, angle, {0, 0, 1});
-
-            for (auto p : tmp) {
-                auto pt = location *vec4{p, 0, 1};
-                points.push_back(pt);
-            }
-        }
-    }
+    // Screen space points, kept between frames to avoid allocations
+    std::vector<glm::vec2> buffer = {};
+    std::vector<MeshVertex> vertices = {};
+    std::vector<int> indices = {};
+};
 
-    void mirror() {
-        auto endSize = points.size();
+// The input parameter that the arrow keys and the mouse wheel change
+enum class EditedParameter {
+    NumTeeth,
+    Module,
+    PreassureAngle,
+};
 
-        auto newPoints = decltype(points){};
-        for (auto p : points) {
-            newPoints.push_back({p.x, -p.y});
-        }
-        reverse();
-        points.insert(points.begin(), newPoints.begin(), newPoints.end());
+GearSettings editSettings(GearSettings settings,
+                          EditedParameter parameter,
+                          int steps) {
+    switch (parameter) {
+    case EditedParameter::NumTeeth:
+        settings.numTeeth = std::clamp(settings.numTeeth + steps, 4, 2000);
+        break;
+    case EditedParameter::Module:
+        settings.module = std::clamp(settings.module + steps, 1, 10);
+        break;
+    case EditedParameter::PreassureAngle:
+        settings.preassureAngle =
+            std::clamp(settings.preassureAngle + steps * .5f, 10.f, 35.f);
+        break;
     }
+    return settings;
+}
 
-    void reverse() {
-        std::reverse(points.begin(), points.end());
-    }
+std::string windowTitle(const GearSettings &settings,
+                        EditedParameter parameter) {
+    auto mark = [parameter](EditedParameter p) {
+        return p == parameter ? "*" : "";
+    };
+    char title[128];
+    std::snprintf(title,
+                  sizeof(title),
+                  "%steeth %d  %smodule %d  %spreassure angle %.1f",
+                  mark(EditedParameter::NumTeeth),
+                  settings.numTeeth,
+                  mark(EditedParameter::Module),
+                  settings.module,
+                  mark(EditedParameter::PreassureAngle),
+                  settings.preassureAngle);
+    return title;
+}
 
-    std::vector<glm::vec2> points;
+struct Arguments {
+    // Write a Chrome trace of the render loop to this file when set
+    std::string tracePath;
+    // Print frame time percentiles while running
+    bool printStats = false;
+    // Only draw the outlines of the gears, not the filled gears
+    bool outlineOnly = false;
 };
 
-struct GearView {
-    GearProfile &gear;
-    glm::vec2 pos;
-    float angle = 0;
-
-    auto createLocation() {
-        mat4 location = identity<mat4>();
-        location = translate(location, vec3{pos, 0});
-        location = rotate(location, angle, {0, 0, 1});
-        return location;
+Arguments parseArguments(int argc, char **argv) {
+    auto args = Arguments{};
+    for (int i = 1; i < argc; ++i) {
+        auto arg = std::string{argv[i]};
+        if (arg == "--trace" && i + 1 < argc) {
+            args.tracePath = argv[++i];
+        }
+        else if (arg == "--stats") {
+            args.printStats = true;
+        }
+        else if (arg == "--outline") {
+            args.outlineOnly = true;
+        }
     }
+    return args;
+}
 
-    void draw(sdl::RendererView view) {
-        auto location = createLocation();
+// Everything the viewer keeps between frames
+//
+// frame() runs one iteration of the main loop. On the desktop it is called
+// in a loop, in the browser the browser calls it once per animation frame,
+// since a loop that never returns would freeze the page
+struct App {
+    App(const Arguments &args)
+        : args{args}
+        , profiler{!args.tracePath.empty()}
+        , window{"sdl window",
+                 SDL_WINDOWPOS_CENTERED,
+                 SDL_WINDOWPOS_CENTERED,
+                 800,
+                 600,
+                 SDL_WINDOW_OPENGL}
+        , renderer{window.get(), -1, SDL_RENDERER_ACCELERATED}
+        , pipeline{GearSettings{
+              .numTeeth = 30, .module = 1, .preassureAngle = 20.}}
+        , model{pipeline.model()} {
+        window.title(windowTitle(model.settings, edited).c_str());
+        applyModel();
+        updateScreenSize();
+        fitGears();
+    }
 
-        auto &points = gear.points;
+    App(const App &) = delete;
+    App &operator=(const App &) = delete;
 
-        for (size_t i = 1; i < points.size(); ++i) {
-            auto p1 = location *vec4{points.at(i - 1), 0, 1};
-            auto p2 = location *vec4{points.at(i), 0, 1};
-            drawLine(view, p1, p2);
+    void updateScreenSize() {
+        int width = 0;
+        int height = 0;
+        SDL_GetRendererOutputSize(renderer.get(), &width, &height);
+        if (width > 0 && height > 0) {
+            camera.screenSize = {width, height};
         }
     }
-};
 
-int main(int argc, char **argv) {
-    auto window = sdl::Window{"sdl window",
-                              SDL_WINDOWPOS_CENTERED,
-                              SDL_WINDOWPOS_CENTERED,
-                              800,
-                              600,
-                              SDL_WINDOW_OPENGL};
-                              
-
-    auto renderer = sdl::Renderer{window.get(), -1, SDL_RENDERER_ACCELERATED};
-
-    if (!renderer) {
-        std::cerr << "could not create renderer\n";
-        return 1;
+    void fitGears() {
+        auto r = model.settings.addendumD / 2;
+        auto margin = glm::vec2{r, r};
+        camera.fit(gearView1.pos - margin, gearView2.pos + margin);
     }
 
-    auto gear =
-        GearProfile{{.numTeeth = 30, .module = 1, .preassureAngle = 20.}};
-
-    auto gearView1 = GearView{gear};
-    auto gearView2 = GearView{gear};
-
-    auto &settings = gear.settings;
-
-    gearView1.pos = {settings.pitchD / 2., settings.pitchD / 2.};
-    gearView2.pos = {gearView1.pos.x + settings.pitchD, gearView1.pos.x};
-
-    auto center = (gearView1.pos + gearView2.pos) / 2.f;
+    void applyModel() {
+        auto &settings = model.settings;
+        for (auto view : {&gearView1, &gearView2}) {
+            view->pyramid = model.pyramid;
+        }
 
-    bool isRunning = true;
-    bool shouldAnimate = false;
+        gearView1.pos = {settings.pitchD / 2., settings.pitchD / 2.};
+        gearView2.pos = {gearView1.pos.x + settings.pitchD, gearView1.pos.x};
+
+        auto isAnimating = simulation && simulation->isAnimating();
+        auto driverAngle = angles.empty() ? 0.f : angles.front();
+        simulation.reset();
+
+        train = GearTrain{};
+        train.add(settings, gearView1.pos);
+        train.add(settings, gearView2.pos);
+        train.connect();
+        train.solve(0);
+
+        simulation.emplace(train.size(),
+                           [this](float angle, auto &out) {
+                               train.update(angle, out);
+                           });
+        simulation->driverAngle(driverAngle);
+        simulation->animate(isAnimating);
+    }
 
-    for (; isRunning;) {
+    void handleEvents() {
         for (auto event = std::optional<sdl::Event>{};
              (event = sdl::pollEvent());) {
 
@@ -234,58 +301,230 @@ int main(int argc, char **argv) {
                 isRunning = false;
                 break;
             }
-            if (event->type == SDL_MOUSEMOTION && !shouldAnimate) {
-                gearView1.angle = 1. / 100. * event->motion.y - 1.;
-
-                window.title(std::to_string(gearView1.angle).c_str());
+            if (event->type == SDL_MOUSEMOTION) {
+                mouse = {event->motion.x, event->motion.y};
+                if (event->motion.state &
+                    (SDL_BUTTON_RMASK | SDL_BUTTON_MMASK)) {
+                    camera.center -=
+                        glm::vec2{event->motion.xrel, event->motion.yrel} /
+                        camera.scale;
+                }
+                else if (!simulation->isAnimating()) {
+                    auto angle = 1. / 100. * event->motion.y - 1.;
+                    simulation->driverAngle(angle);
+                }
             }
-            else if (event->type == SDL_MOUSEBUTTONDOWN) {
-                shouldAnimate = !shouldAnimate;
+            else if (event->type == SDL_MOUSEBUTTONDOWN &&
+                     event->button.button == SDL_BUTTON_LEFT) {
+                simulation->animate(!simulation->isAnimating());
+            }
+            else if (event->type == SDL_MOUSEWHEEL) {
+                camera.zoom(std::pow(1.25f, event->wheel.y), mouse);
+            }
+            else if (event->type == SDL_KEYDOWN) {
+                auto steps = 0;
+                switch (event->key.keysym.sym) {
+                case SDLK_t:
+                    edited = EditedParameter::NumTeeth;
+                    break;
+                case SDLK_m:
+                    edited = EditedParameter::Module;
+                    break;
+                case SDLK_p:
+                    edited = EditedParameter::PreassureAngle;
+                    break;
+                case SDLK_UP:
+                    steps = 1;
+                    break;
+                case SDLK_DOWN:
+                    steps = -1;
+                    break;
+                case SDLK_0:
+                    fitGears();
+                    break;
+                }
+                auto settings =
+                    editSettings(pipeline.requested(), edited, steps);
+                if (steps) {
+                    pipeline.request(settings);
+                }
+                window.title(windowTitle(settings, edited).c_str());
             }
         }
+    }
 
-        gearView1.angle += shouldAnimate * .004;
-        gearView2.angle =
-            -gearView1.angle + pi<float>() + settings.pitchAngle / 2.f;
+    void draw() {
+        auto &settings = model.settings;
+        updateScreenSize();
 
         renderer.drawColor({100, 0, 0, 255});
         renderer.clear();
+
+        if (!args.outlineOnly) {
+            gearView1.drawFilled(renderer, camera, {140, 140, 140});
+            gearView2.drawFilled(renderer, camera, {140, 140, 140});
+        }
+
         renderer.drawColor({100, 100, 100, 255});
 
         drawLine(renderer,
+                 camera,
                  gearView1.pos,
                  gearView1.pos +
                      settings.pitchD / 2.f *
                          vec2{cos(gearView1.angle), sin(gearView1.angle)});
         drawLine(renderer,
+                 camera,
                  gearView1.pos,
                  gearView1.pos +
                      settings.pitchD / 2.f *
                          vec2{cos(gearView1.angle + settings.pitchAngle),
                               sin(gearView1.angle + settings.pitchAngle)});
 
-        drawArc(renderer, gearView1.pos, settings.addendumD / 2);
-        drawArc(renderer, gearView1.pos, settings.clearingD / 2);
-        drawArc(renderer, gearView2.pos, settings.pitchD / 2);
+        auto &circles = *model.circles;
+        drawLines(renderer, camera, circles.addendum, gearView1.pos);
+        drawLines(renderer, camera, circles.clearing, gearView1.pos);
+        drawLines(renderer, camera, circles.pitch, gearView2.pos);
 
         renderer.drawColor({0, 0, 30});
-        drawArc(renderer, gearView1.pos, settings.dedendumD / 2);
+        drawLines(renderer, camera, circles.dedendum, gearView1.pos);
 
         renderer.drawColor({200, 0, 0});
-        drawArc(renderer, gearView1.pos, settings.baseD / 2);
+        drawLines(renderer, camera, circles.base, gearView1.pos);
 
         renderer.drawColor({200, 200, 200});
-        drawArc(renderer, gearView1.pos, settings.pitchD / 2);
+        drawLines(renderer, camera, circles.pitch, gearView1.pos);
 
-        gearView1.draw(renderer);
-        gearView2.draw(renderer);
+        gearView1.draw(renderer, camera);
+        gearView2.draw(renderer, camera);
 
         renderer.drawColor({255, 255, 255});
+    }
+
+    // One iteration of the main loop. Returns false when the window is closed
+    bool frame() {
+        auto frameScope = Profiler::Scope{profiler, "frame"};
+
+        {
+            auto scope = Profiler::Scope{profiler, "events"};
+            handleEvents();
+        }
+        if (!isRunning) {
+            return false;
+        }
+
+        // New models come from the pipeline thread, so the frame never waits
+        // for profiles to be generated
+        if (pipeline.update()) {
+            model = pipeline.model();
+            applyModel();
+        }
+
+        simulation->interpolate(angles);
+        gearView1.angle = angles.at(0);
+        gearView2.angle = angles.at(1);
 
-        renderer.present();
-        std::this_thread::sleep_for(10ms);
+        {
+            auto scope = Profiler::Scope{profiler, "draw"};
+            draw();
+        }
+
+        {
+            auto scope = Profiler::Scope{profiler, "present"};
+            renderer.present();
+        }
+
+#ifndef __EMSCRIPTEN__
+        {
+            auto scope = Profiler::Scope{profiler, "sleep"};
+            std::this_thread::sleep_for(10ms);
+        }
+#endif
+
+        if (args.printStats && ++frameCount % Profiler::historySize == 0) {
+            profiler.printSummary(std::cout);
+        }
+
+        return true;
     }
 
-    return 0;
+    // Stop the threads and write the statistics
+    void finish() {
+        simulation.reset();
+
+        profiler.printSummary(std::cout);
+
+        if (profiler.isTracing()) {
+            if (profiler.writeChromeTrace(args.tracePath)) {
+                std::cout << "wrote trace to " << args.tracePath << "\n";
+            }
+            else {
+                std::cerr << "could not write " << args.tracePath << "\n";
+            }
+        }
+    }
+
+    Arguments args;
+    Profiler profiler;
+    size_t frameCount = 0;
+    bool isRunning = true;
+
+    sdl::Window window;
+    sdl::Renderer renderer;
+
+    // Edits are rebuilt on a background thread (a web worker in the
+    // browser), and the views pick up the new model when it is ready
+    AsyncGearPipeline pipeline;
+    GearModel model;
+    EditedParameter edited = EditedParameter::NumTeeth;
+
+    GearView gearView1;
+    GearView gearView2;
+
+    Camera camera;
+    glm::vec2 mouse = {};
+
+    GearTrain train;
+
+    // Kinematics runs on its own thread, so gear speed does not depend on the
+    // frame rate. It is restarted when the gears are edited, since the train
+    // it solves changes
+    std::optional<Simulation> simulation;
+    std::vector<float> angles;
+};
+
+#ifdef __EMSCRIPTEN__
+
+void browserFrame(void *data) {
+    auto app = static_cast<App *>(data);
+    if (!app->frame()) {
+        emscripten_cancel_main_loop();
+        app->finish();
+        delete app;
+    }
 }
 
+#endif
+
+int main(int argc, char **argv) {
+    // On the heap, since main returns before the first frame in the browser
+    auto app = std::make_unique<App>(parseArguments(argc, argv));
+
+    if (!app->renderer) {
+        std::cerr << "could not create renderer\n";
+        return 1;
+    }
+
+#ifdef __EMSCRIPTEN__
+    // The browser calls browserFrame once per animation frame, timed with
+    // requestAnimationFrame
+    emscripten_set_main_loop_arg(browserFrame, app.release(), 0, false);
+#else
+    for (; app->frame();) {
+    }
+
+    app->finish();
+#endif
+
+    return 0;
+}
@@ -0,0 +1,206 @@
+#include "meshanalysis.h"
+#include "geartrain.h"
+#include "interference.h"
+#include "threadpool.h"
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <limits>
+#include <ostream>
+
+namespace {
+
+// Stop searching for contact when the flanks are this close, relative to
+// the module
+constexpr float contactTolerance = 1e-5f;
+
+constexpr int maxContactIterations = 64;
+
+SegmentBvh makeBvh(const GearSettings &settings, ProfileSampling sampling) {
+    auto points = std::vector<glm::vec2>(profileSize(settings, sampling));
+    generateProfile(settings, points.data(), points.size(), sampling);
+    return SegmentBvh{std::move(points)};
+}
+
+// Turn gear b from idealAngle in direction (1 or -1) until it touches gear a
+// at angleA, and return how far it was turned
+//
+// Turning b by da moves no point of b further than radius * da, where radius
+// is the addendum radius, so b can always be turned by clearance / radius
+// without passing through a. The clearance shrinks by a constant factor for
+// each step, since involute flanks are moved along the line of action by
+// the base radius * da
+float contactOffset(const SegmentBvh &a,
+                    const SegmentBvh &b,
+                    float centerDistance,
+                    float angleA,
+                    float idealAngle,
+                    float direction,
+                    float radius,
+                    float limit,
+                    float tolerance) {
+    auto offset = 0.f;
+    for (int i = 0; i < maxContactIterations; ++i) {
+        auto angleB = idealAngle + direction * offset;
+        auto c = clearance(
+            a, {{0, 0}, angleA}, b, {{centerDistance, 0}, angleB});
+        if (c.isColliding || c.distance <= tolerance) {
+            return offset;
+        }
+        offset += c.distance / radius;
+        if (offset > limit) {
+            return std::numeric_limits<float>::quiet_NaN();
+        }
+    }
+    return offset;
+}
+
+} // namespace
+
+float contactRatio(const GearSettings &a,
+                   const GearSettings &b,
+                   float centerDistance) {
+    auto baseA = a.baseD / 2.f;
+    auto baseB = b.baseD / 2.f;
+    if (centerDistance <= baseA + baseB) {
+        return 0;
+    }
+
+    // The working pressure angle grows with the center distance
+    auto cosAngle = (baseA + baseB) / centerDistance;
+    auto sinAngle = std::sqrt(1 - cosAngle * cosAngle);
+
+    auto approach = [](const GearSettings &settings) {
+        auto r = settings.addendumD / 2.f;
+        auto base = settings.baseD / 2.f;
+        return std::sqrt(r * r - base * base);
+    };
+
+    auto length = approach(a) + approach(b) - centerDistance * sinAngle;
+    auto basePitch = a.pitchAngle * baseA;
+    return std::max(length / basePitch, 0.f);
+}
+
+MeshAnalysis analyzeMesh(const GearSettings &a,
+                         const GearSettings &b,
+                         float centerDistance,
+                         int numSteps,
+                         ThreadPool &pool,
+                         ProfileSampling sampling) {
+    auto bvhA = makeBvh(a, sampling);
+    auto bvhB = makeBvh(b, sampling);
+
+    auto tolerance = contactTolerance * static_cast<float>(a.module);
+
+    // Teeth that touch in theory can be apart by the chord error of both
+    // flanks in the polygons
+    auto contactDistance =
+        2 * (flankDeviation(a, sampling) + flankDeviation(b, sampling)) +
+        2 * tolerance;
+    auto segmentsPerTooth = 2 * halfToothSize(sampling);
+
+    auto radiusB = b.addendumD / 2.f;
+    auto pitchRadiusB = b.pitchD / 2.f;
+
+    auto analysis = MeshAnalysis{};
+    analysis.contactRatio = contactRatio(a, b, centerDistance);
+
+    numSteps = std::max(numSteps, 1);
+    analysis.steps.resize(numSteps);
+
+    pool.parallelFor(numSteps, [&](size_t i) {
+        auto &step = analysis.steps[i];
+        step.angle = a.pitchAngle * static_cast<float>(i) / numSteps;
+        step.idealAngle = meshingAngle(a, step.angle, b, 0);
+
+        auto ideal = clearance(bvhA,
+                               {{0, 0}, step.angle},
+                               bvhB,
+                               {{centerDistance, 0}, step.idealAngle});
+        if (ideal.isColliding) {
+            step.isColliding = true;
+            return;
+        }
+
+        auto drive = contactOffset(bvhA,
+                                   bvhB,
+                                   centerDistance,
+                                   step.angle,
+                                   step.idealAngle,
+                                   1,
+                                   radiusB,
+                                   b.pitchAngle,
+                                   tolerance);
+        auto coast = contactOffset(bvhA,
+                                   bvhB,
+                                   centerDistance,
+                                   step.angle,
+                                   step.idealAngle,
+                                   -1,
+                                   radiusB,
+                                   b.pitchAngle,
+                                   tolerance);
+
+        step.transmissionErrorAngle = drive;
+        step.transmissionError = drive * pitchRadiusB;
+        step.backlashAngle = drive + coast;
+        step.backlash = step.backlashAngle * pitchRadiusB;
+        // Turning b in the positive direction closes the gap on the flanks
+        // of b that face the positive direction
+        auto contacts =
+            countContacts(bvhA,
+                          {{0, 0}, step.angle},
+                          bvhB,
+                          {{centerDistance, 0}, step.idealAngle + drive},
+                          contactDistance,
+                          segmentsPerTooth);
+        step.contacts = contacts.positive;
+    });
+
+    auto minError = std::numeric_limits<float>::infinity();
+    auto maxError = -minError;
+    analysis.minBacklash = minError;
+    analysis.maxBacklash = maxError;
+    auto totalContacts = 0;
+    for (auto &step : analysis.steps) {
+        if (step.isColliding) {
+            ++analysis.numCollisions;
+            continue;
+        }
+        minError = std::min(minError, step.transmissionError);
+        maxError = std::max(maxError, step.transmissionError);
+        analysis.minBacklash = std::min(analysis.minBacklash, step.backlash);
+        analysis.maxBacklash = std::max(analysis.maxBacklash, step.backlash);
+        totalContacts += step.contacts;
+    }
+
+    auto numValid = numSteps - analysis.numCollisions;
+    if (numValid > 0) {
+        analysis.transmissionErrorPeakToPeak = maxError - minError;
+        analysis.meanContacts = static_cast<float>(totalContacts) / numValid;
+    }
+    else {
+        analysis.minBacklash = analysis.maxBacklash = 0;
+    }
+
+    return analysis;
+}
+
+void writeMeshCsv(const MeshAnalysis &analysis, std::ostream &out) {
+    out << "step,angle,ideal_angle,transmission_error_angle,"
+           "transmission_error,backlash_angle,backlash,contacts,colliding\n";
+    out << std::setprecision(9);
+    for (size_t i = 0; i < analysis.steps.size(); ++i) {
+        auto &step = analysis.steps[i];
+        out << i << ',' << step.angle << ',' << step.idealAngle << ',';
+        if (step.isColliding) {
+            // Leave the values empty so that they are not mistaken for a
+            // perfect mesh
+            out << ",,,,,1\n";
+            continue;
+        }
+        out << step.transmissionErrorAngle << ',' << step.transmissionError
+            << ',' << step.backlashAngle << ',' << step.backlash << ','
+            << step.contacts << ",0\n";
+    }
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "gearsettings.h"
+#include "profilegenerator.h"
+#include <iosfwd>
+#include <vector>
+
+class ThreadPool;
+
+// Contact ratio from the line of action: the length of the path of contact
+// divided by the base pitch. The path of contact is the part of the line of
+// action (the common tangent of the base circles) inside both addendum
+// circles. Returns 0 if the base circles overlap at this center distance
+float contactRatio(const GearSettings &a,
+                   const GearSettings &b,
+                   float centerDistance);
+
+struct MeshStep {
+    // Angle of gear a, and the angle of gear b for perfect conjugate action
+    float angle = 0;
+    float idealAngle = 0;
+
+    // Rotation of gear b away from the ideal angle until the driving flanks
+    // touch (gear a turning in the positive direction and pushing gear b).
+    // Angles are in radians on gear b, lengths along the pitch circle of b
+    float transmissionErrorAngle = 0;
+    float transmissionError = 0;
+
+    // Free rotation of gear b between the driving and the coasting flanks
+    float backlashAngle = 0;
+    float backlash = 0;
+
+    // Number of teeth in contact on the driving flanks
+    int contacts = 0;
+
+    // The profiles overlap at the ideal angle, the other values are not set
+    bool isColliding = false;
+};
+
+struct MeshAnalysis {
+    float contactRatio = 0;
+
+    std::vector<MeshStep> steps;
+
+    // Average number of teeth in contact over the steps, which is the
+    // measured contact ratio
+    float meanContacts = 0;
+
+    float transmissionErrorPeakToPeak = 0;
+    float minBacklash = 0;
+    float maxBacklash = 0;
+    int numCollisions = 0;
+};
+
+// Place gear a at origin and gear b at (centerDistance, 0) and rotate a
+// through one pitch in numSteps steps. For every step gear b is turned from
+// the ideal angle in both directions until the flanks touch, which gives the
+// transmission error and the backlash. The steps are spread over the pool
+//
+// The profiles are polygons, so the results are only as accurate as the
+// sampling: use adaptive sampling with a small tolerance
+MeshAnalysis analyzeMesh(const GearSettings &a,
+                         const GearSettings &b,
+                         float centerDistance,
+                         int numSteps,
+                         ThreadPool &pool,
+                         ProfileSampling sampling = {});
+
+// Write one line per step, with a header
+void writeMeshCsv(const MeshAnalysis &analysis, std::ostream &out);
@@ -0,0 +1,231 @@
+#include "pairsearch.h"
+#include "geartrain.h"
+#include "interference.h"
+#include "meshanalysis.h"
+#include "threadpool.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+// Length of the line of action from where it touches the base circle out to
+// the addendum circle
+float approachLength(const GearSettings &settings) {
+    auto r = settings.addendumD / 2.f;
+    auto base = settings.baseD / 2.f;
+    return std::sqrt(r * r - base * base);
+}
+
+// A pair that passed the analytic checks, kept small since there can be
+// millions of them
+struct Pair {
+    int teethA;
+    int teethB;
+    int module;
+    float preassureAngle;
+    float ratioError;
+    float contactRatio;
+};
+
+PairCandidate makeCandidate(const PairSearch &search, const Pair &pair) {
+    auto candidate = PairCandidate{};
+    candidate.a = GearSettings{.numTeeth = pair.teethA,
+                               .module = pair.module,
+                               .preassureAngle = pair.preassureAngle};
+    candidate.b = GearSettings{.numTeeth = pair.teethB,
+                               .module = pair.module,
+                               .preassureAngle = pair.preassureAngle};
+    candidate.centerDistance =
+        search.centerDistance > 0
+            ? search.centerDistance
+            : (candidate.a.pitchD + candidate.b.pitchD) / 2.f;
+    candidate.ratio = static_cast<float>(pair.teethB) / pair.teethA;
+    candidate.ratioError = pair.ratioError;
+    candidate.contactRatio = pair.contactRatio;
+    return candidate;
+}
+
+// The analytic checks, see searchPairs()
+bool isFeasible(const PairCandidate &candidate, float minContactRatio) {
+    auto &a = candidate.a;
+    auto &b = candidate.b;
+    auto d = candidate.centerDistance;
+
+    if (a.addendumD / 2.f + b.dedendumD / 2.f > d ||
+        b.addendumD / 2.f + a.dedendumD / 2.f > d) {
+        return false;
+    }
+
+    // Length of the line of action between the base circles
+    auto baseSum = (a.baseD + b.baseD) / 2.f;
+    if (d <= baseSum) {
+        return false;
+    }
+    auto lineOfAction = std::sqrt(d * d - baseSum * baseSum);
+    if (approachLength(a) > lineOfAction || approachLength(b) > lineOfAction) {
+        return false;
+    }
+
+    return candidate.contactRatio >= minContactRatio;
+}
+
+// Closest ratio first, then the fewest teeth, which is the smallest pair or,
+// at a fixed center distance, the one with the strongest teeth. Ties go to
+// the pair with the smaller module and then the higher contact ratio
+bool isBetter(const Pair &x, const Pair &y) {
+    if (x.ratioError != y.ratioError) {
+        return x.ratioError < y.ratioError;
+    }
+    if (x.teethA + x.teethB != y.teethA + y.teethB) {
+        return x.teethA + x.teethB < y.teethA + y.teethB;
+    }
+    if (x.module != y.module) {
+        return x.module < y.module;
+    }
+    return x.contactRatio > y.contactRatio;
+}
+
+// Every pair with teethA teeth on gear a that is within the constraints,
+// see searchPairs()
+void enumeratePairs(const PairSearch &search,
+                    int teethA,
+                    std::vector<Pair> &feasible,
+                    size_t &numEnumerated) {
+    auto target = search.ratio * teethA;
+    auto ratioFirst =
+        static_cast<int>(std::ceil(target * (1 - search.ratioTolerance)));
+    auto ratioLast =
+        static_cast<int>(std::floor(target * (1 + search.ratioTolerance)));
+
+    for (int module = std::max(1, search.minModule);
+         module <= search.maxModule;
+         ++module) {
+        auto first = std::max(search.minTeeth, ratioFirst);
+        auto last = std::min(search.maxTeeth, ratioLast);
+        if (search.centerDistance > 0) {
+            // Teeth of both gears together that give a standard distance
+            // close enough to the requested one
+            auto low = search.centerDistance - search.centerTolerance;
+            auto high = search.centerDistance + search.centerTolerance;
+            auto minSum = static_cast<int>(std::ceil(low * 2.f / module));
+            auto maxSum = static_cast<int>(std::floor(high * 2.f / module));
+            first = std::max(first, minSum - teethA);
+            last = std::min(last, maxSum - teethA);
+        }
+
+        for (auto teethB = first; teethB <= last; ++teethB) {
+            auto ratio = static_cast<float>(teethB) / teethA;
+            for (auto angle : search.preassureAngles) {
+                ++numEnumerated;
+                auto pair = Pair{teethA,
+                                 teethB,
+                                 module,
+                                 angle,
+                                 std::abs(ratio - search.ratio) / search.ratio,
+                                 0};
+                auto candidate = makeCandidate(search, pair);
+                candidate.contactRatio = contactRatio(
+                    candidate.a, candidate.b, candidate.centerDistance);
+                if (isFeasible(candidate, search.minContactRatio)) {
+                    pair.contactRatio = candidate.contactRatio;
+                    feasible.push_back(pair);
+                }
+            }
+        }
+    }
+}
+
+SegmentBvh makeBvh(const GearSettings &settings, ProfileSampling sampling) {
+    auto points = std::vector<glm::vec2>(profileSize(settings, sampling));
+    generateProfile(settings, points.data(), points.size(), sampling);
+    return SegmentBvh{std::move(points)};
+}
+
+// Like sweepMesh() but on the calling thread, since the pairs are what is
+// spread over the pool. Returns false on the first collision
+bool sweepPair(PairCandidate &candidate,
+               int numSteps,
+               ProfileSampling sampling) {
+    auto &a = candidate.a;
+    auto &b = candidate.b;
+    auto bvhA = makeBvh(a, sampling);
+    auto bvhB = makeBvh(b, sampling);
+
+    candidate.minClearance = std::numeric_limits<float>::infinity();
+    for (int i = 0; i < numSteps; ++i) {
+        auto angle = a.pitchAngle * static_cast<float>(i) / numSteps;
+        auto c = clearance(bvhA,
+                           {{0, 0}, angle},
+                           bvhB,
+                           {{candidate.centerDistance, 0},
+                            meshingAngle(a, angle, b, 0)});
+        if (c.isColliding) {
+            candidate.minClearance = 0;
+            return false;
+        }
+        candidate.minClearance = std::min(candidate.minClearance, c.distance);
+    }
+    return true;
+}
+
+} // namespace
+
+PairSearchResult searchPairs(const PairSearch &search, ThreadPool &pool) {
+    auto result = PairSearchResult{};
+    if (search.ratio <= 0 || search.minTeeth > search.maxTeeth) {
+        return result;
+    }
+
+    // Enumerated in parallel over the teeth of gear a
+    auto numTeethA = static_cast<size_t>(search.maxTeeth - search.minTeeth + 1);
+    auto lists = std::vector<std::vector<Pair>>(numTeethA);
+    auto counts = std::vector<size_t>(numTeethA);
+    pool.parallelFor(numTeethA, [&](size_t i) {
+        enumeratePairs(search,
+                       search.minTeeth + static_cast<int>(i),
+                       lists[i],
+                       counts[i]);
+    });
+
+    auto feasible = std::vector<Pair>{};
+    for (size_t i = 0; i < numTeethA; ++i) {
+        result.numEnumerated += counts[i];
+        feasible.insert(feasible.end(), lists[i].begin(), lists[i].end());
+        lists[i] = {};
+    }
+    result.numPruned = result.numEnumerated - feasible.size();
+
+    std::sort(feasible.begin(), feasible.end(), isBetter);
+
+    // Sweep in batches until there are enough results. The batches are in
+    // rank order, so the first pairs that pass are the best ones
+    auto numSteps = std::max(1, search.numSteps);
+    auto batchSize = pool.size() * 4;
+    auto batch = std::vector<PairCandidate>(batchSize);
+    auto isClear = std::vector<char>(batchSize);
+    for (size_t begin = 0; begin < feasible.size() &&
+                           result.candidates.size() < search.maxResults;
+         begin += batchSize) {
+        auto num = std::min(batchSize, feasible.size() - begin);
+        pool.parallelFor(
+            num,
+            [&](size_t i) {
+                batch[i] = makeCandidate(search, feasible[begin + i]);
+                isClear[i] = sweepPair(batch[i], numSteps, search.sampling);
+            },
+            1);
+
+        result.numSwept += num;
+        for (size_t i = 0; i < num; ++i) {
+            if (!isClear[i]) {
+                ++result.numColliding;
+            }
+            else if (result.candidates.size() < search.maxResults) {
+                result.candidates.push_back(batch[i]);
+            }
+        }
+    }
+
+    return result;
+}
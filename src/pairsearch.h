@@ -0,0 +1,86 @@
+#pragma once
+
+#include "gearsettings.h"
+#include "profilegenerator.h"
+#include <cstddef>
+#include <vector>
+
+class ThreadPool;
+
+// Constraints for searching gear pairs
+//
+// Both gears of a pair have the same module and preassure angle, since
+// anything else does not mesh
+struct PairSearch {
+    // Teeth of gear b divided by teeth of gear a, and how far from it the
+    // ratio of a pair may be, relative to the ratio
+    float ratio = 2;
+    float ratioTolerance = .01f;
+
+    // 0 for the standard distance (the sum of the pitch radii) of every
+    // pair. Otherwise the pairs are run at this distance, and their standard
+    // distance has to be within centerTolerance of it
+    float centerDistance = 0;
+    float centerTolerance = .5f;
+
+    int minTeeth = 8;
+    int maxTeeth = 200;
+    int minModule = 1;
+    int maxModule = 10;
+    std::vector<float> preassureAngles = {14.5f, 20, 25};
+
+    float minContactRatio = 1.2f;
+
+    // Angles checked for interference over one pitch of gear a
+    int numSteps = 64;
+    ProfileSampling sampling;
+
+    size_t maxResults = 20;
+};
+
+struct PairCandidate {
+    GearSettings a;
+    GearSettings b;
+    float centerDistance = 0;
+    float ratio = 0;
+    // Relative to the requested ratio
+    float ratioError = 0;
+    float contactRatio = 0;
+    // Smallest distance between the profiles over the sweep
+    float minClearance = 0;
+};
+
+struct PairSearchResult {
+    // Best first
+    std::vector<PairCandidate> candidates;
+
+    // Pairs within the ratio and center distance constraints
+    size_t numEnumerated = 0;
+    // Pairs removed by the analytic checks, before any profile was generated
+    size_t numPruned = 0;
+    // Pairs whose profiles were swept, and how many of those collided
+    size_t numSwept = 0;
+    size_t numColliding = 0;
+};
+
+// Find the best pairs for the constraints
+//
+// The teeth of gear b and the modules are solved for from the ratio and the
+// center distance instead of enumerated, so wide ranges are cheap. The pairs
+// are then checked in order of cost:
+//
+// 1. Contact ratio from the line of action, see contactRatio()
+// 2. Involute interference: the addendum circle of each gear must not reach
+//    past the point where the line of action touches the base circle of the
+//    other gear, or the tip digs into the part of the flank below the base
+//    circle
+// 3. Tip to root: the addendum circle of each gear must stay outside the
+//    dedendum circle of the other
+//
+// The pairs left are ranked by ratio error first and the total number of
+// teeth second, so the smallest pair (or at a fixed center distance the one
+// with the largest module) comes first. They are then swept for collisions
+// with the generated profiles in rank order, in parallel batches on the
+// pool, until maxResults pairs without collisions are found. So the profiles
+// of most pairs are never generated
+PairSearchResult searchPairs(const PairSearch &search, ThreadPool &pool);
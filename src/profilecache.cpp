@@ -0,0 +1,273 @@
+#include "profilecache.h"
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+constexpr char fileMagic[8] = "INVGEAR";
+constexpr uint32_t byteOrderMark = 0x01020304;
+
+struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    int32_t numTeeth;
+    int32_t module;
+    float preassureAngle;
+    int32_t steps;
+    int32_t isAdaptive;
+    uint32_t padding;
+    uint64_t numPoints;
+};
+
+static_assert(sizeof(glm::vec2) == sizeof(float) * 2,
+              "profile files store the points as they are in memory");
+static_assert(sizeof(FileHeader) % alignof(glm::vec2) == 0);
+
+bool isValid(const FileHeader &header, const ProfileKey &key, size_t fileSize) {
+    return std::memcmp(header.magic, fileMagic, sizeof(fileMagic)) == 0 &&
+           header.version == ProfileCache::fileVersion &&
+           header.byteOrder == byteOrderMark &&
+           header.numTeeth == key.numTeeth && header.module == key.module &&
+           header.preassureAngle == key.preassureAngle &&
+           header.steps == key.steps &&
+           (header.isAdaptive != 0) == key.isAdaptive &&
+           fileSize == sizeof(FileHeader) +
+                           header.numPoints * sizeof(glm::vec2);
+}
+
+template <typename T>
+void hashValue(uint64_t &hash, T value) {
+    unsigned char bytes[sizeof(T)];
+    std::memcpy(bytes, &value, sizeof(T));
+    for (auto b : bytes) {
+        hash ^= b;
+        hash *= 0x100000001b3ull;
+    }
+}
+
+} // namespace
+
+ProfileKey profileKey(const GearSettings &settings, ProfileSampling sampling) {
+    return {
+        .numTeeth = settings.numTeeth,
+        .module = settings.module,
+        .preassureAngle = settings.preassureAngle,
+        .steps = sampling.steps,
+        .isAdaptive = sampling.isAdaptive,
+    };
+}
+
+uint64_t hashProfileKey(const ProfileKey &key) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    hashValue(hash, static_cast<int32_t>(key.numTeeth));
+    hashValue(hash, static_cast<int32_t>(key.module));
+    hashValue(hash, key.preassureAngle);
+    hashValue(hash, static_cast<int32_t>(key.steps));
+    hashValue(hash, static_cast<int32_t>(key.isAdaptive));
+    return hash;
+}
+
+CachedProfile::CachedProfile(ProfileKey key, std::vector<glm::vec2> points)
+    : _key{key}
+    , _owned{std::move(points)} {
+    _data = _owned.data();
+    _size = _owned.size();
+}
+
+CachedProfile::~CachedProfile() {
+#ifndef _WIN32
+    if (_mapping) {
+        munmap(_mapping, _mappingSize);
+    }
+#endif
+}
+
+std::shared_ptr<const CachedProfile> CachedProfile::load(
+    const std::string &path, const ProfileKey &key) {
+    auto profile = std::shared_ptr<CachedProfile>{new CachedProfile{}};
+    profile->_key = key;
+
+#ifndef _WIN32
+    auto fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return nullptr;
+    }
+
+    struct stat st = {};
+    if (fstat(fd, &st) ||
+        static_cast<size_t>(st.st_size) < sizeof(FileHeader)) {
+        ::close(fd);
+        return nullptr;
+    }
+
+    auto size = static_cast<size_t>(st.st_size);
+    auto mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        return nullptr;
+    }
+
+    profile->_mapping = mapping;
+    profile->_mappingSize = size;
+
+    auto &header = *static_cast<const FileHeader *>(mapping);
+    if (!isValid(header, key, size)) {
+        return nullptr;
+    }
+
+    profile->_data = reinterpret_cast<const glm::vec2 *>(
+        static_cast<const char *>(mapping) + sizeof(FileHeader));
+    profile->_size = header.numPoints;
+#else
+    // No memory mapping, read the file instead
+    auto file = std::ifstream{path, std::ios::binary | std::ios::ate};
+    if (!file) {
+        return nullptr;
+    }
+    auto size = static_cast<size_t>(file.tellg());
+    file.seekg(0);
+
+    auto header = FileHeader{};
+    if (size < sizeof(header) ||
+        !file.read(reinterpret_cast<char *>(&header), sizeof(header)) ||
+        !isValid(header, key, size)) {
+        return nullptr;
+    }
+
+    profile->_owned.resize(header.numPoints);
+    if (!file.read(reinterpret_cast<char *>(profile->_owned.data()),
+                   header.numPoints * sizeof(glm::vec2))) {
+        return nullptr;
+    }
+    profile->_data = profile->_owned.data();
+    profile->_size = profile->_owned.size();
+#endif
+
+    return profile;
+}
+
+bool saveCachedProfile(const std::string &path, const CachedProfile &profile) {
+    auto &key = profile.key();
+    auto header = FileHeader{};
+    std::memcpy(header.magic, fileMagic, sizeof(fileMagic));
+    header.version = ProfileCache::fileVersion;
+    header.byteOrder = byteOrderMark;
+    header.numTeeth = key.numTeeth;
+    header.module = key.module;
+    header.preassureAngle = key.preassureAngle;
+    header.steps = key.steps;
+    header.isAdaptive = key.isAdaptive;
+    header.numPoints = profile.size();
+
+    // Unique per writer so that processes sharing the directory does not
+    // overwrite each others temporary files
+    auto tmpPath = path + ".tmp" + std::to_string(std::random_device{}());
+    {
+        auto file = std::ofstream{tmpPath, std::ios::binary};
+        file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char *>(profile.data()),
+                   profile.size() * sizeof(glm::vec2));
+        if (!file) {
+            std::remove(tmpPath.c_str());
+            return false;
+        }
+    }
+
+    if (std::rename(tmpPath.c_str(), path.c_str())) {
+        std::remove(tmpPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+ProfileCache::ProfileCache(std::string directory, size_t capacity)
+    : _directory{std::move(directory)}
+    , _capacity{capacity} {
+    if (!_directory.empty()) {
+        // Failures show up as write failures in the stats
+        auto error = std::error_code{};
+        std::filesystem::create_directories(_directory, error);
+    }
+}
+
+std::string ProfileCache::path(const ProfileKey &key) const {
+    char name[32];
+    std::snprintf(name,
+                  sizeof(name),
+                  "%016llx.gear",
+                  static_cast<unsigned long long>(hashProfileKey(key)));
+    return _directory + "/" + name;
+}
+
+std::shared_ptr<const CachedProfile> ProfileCache::get(
+    const GearSettings &settings, ProfileSampling sampling) {
+    auto key = profileKey(settings, sampling);
+
+    {
+        auto lock = std::unique_lock{_mutex};
+        if (auto it = _lookup.find(key); it != _lookup.end()) {
+            _lru.splice(_lru.begin(), _lru, it->second);
+            ++_stats.memoryHits;
+            return it->second->second;
+        }
+    }
+
+    // Disk and computation is done without holding the lock. Two threads
+    // asking for the same profile might both compute it, which is harmless
+    if (!_directory.empty()) {
+        if (auto profile = CachedProfile::load(path(key), key)) {
+            auto lock = std::unique_lock{_mutex};
+            ++_stats.diskHits;
+            insert(key, profile);
+            return profile;
+        }
+    }
+
+    auto points = std::vector<glm::vec2>(profileSize(settings, sampling));
+    generateProfile(settings, points.data(), points.size(), sampling);
+    auto profile =
+        std::make_shared<const CachedProfile>(key, std::move(points));
+
+    auto isSaved =
+        _directory.empty() || saveCachedProfile(path(key), *profile);
+
+    auto lock = std::unique_lock{_mutex};
+    ++_stats.computed;
+    if (!isSaved) {
+        ++_stats.writeFailures;
+    }
+    insert(key, profile);
+    return profile;
+}
+
+ProfileCache::Stats ProfileCache::stats() const {
+    auto lock = std::unique_lock{_mutex};
+    return _stats;
+}
+
+void ProfileCache::insert(const ProfileKey &key,
+                          std::shared_ptr<const CachedProfile> profile) {
+    if (auto it = _lookup.find(key); it != _lookup.end()) {
+        _lru.splice(_lru.begin(), _lru, it->second);
+        return;
+    }
+
+    _lru.emplace_front(key, std::move(profile));
+    _lookup[key] = _lru.begin();
+
+    while (_lru.size() > _capacity) {
+        _lookup.erase(_lru.back().first);
+        _lru.pop_back();
+    }
+}
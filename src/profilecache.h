@@ -0,0 +1,146 @@
+#pragma once
+
+#include "gearsettings.h"
+#include "profilegenerator.h"
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// The input parameters that decides what a profile looks like
+struct ProfileKey {
+    int numTeeth = 0;
+    int module = 0;
+    float preassureAngle = 0;
+    int steps = defaultProfileSteps;
+    bool isAdaptive = false;
+
+    bool operator==(const ProfileKey &other) const {
+        return numTeeth == other.numTeeth && module == other.module &&
+               preassureAngle == other.preassureAngle &&
+               steps == other.steps && isAdaptive == other.isAdaptive;
+    }
+
+    bool operator!=(const ProfileKey &other) const {
+        return !(*this == other);
+    }
+};
+
+ProfileKey profileKey(const GearSettings &settings,
+                      ProfileSampling sampling = {});
+
+// 64 bit FNV-1a hash of the key. Stable between runs and platforms so it can
+// be used for file names
+uint64_t hashProfileKey(const ProfileKey &key);
+
+struct ProfileKeyHash {
+    size_t operator()(const ProfileKey &key) const {
+        return static_cast<size_t>(hashProfileKey(key));
+    }
+};
+
+// Read only profile points, either owned or pointing into a memory mapped
+// file. The points are laid out like generateProfile() writes them
+class CachedProfile {
+public:
+    // Take ownership of computed points
+    CachedProfile(ProfileKey key, std::vector<glm::vec2> points);
+
+    // Map a profile file. Returns nullptr if the file does not exist, is from
+    // another version or does not match key
+    static std::shared_ptr<const CachedProfile> load(const std::string &path,
+                                                     const ProfileKey &key);
+
+    CachedProfile(const CachedProfile &) = delete;
+    CachedProfile &operator=(const CachedProfile &) = delete;
+    ~CachedProfile();
+
+    const ProfileKey &key() const {
+        return _key;
+    }
+
+    const glm::vec2 *data() const {
+        return _data;
+    }
+
+    size_t size() const {
+        return _size;
+    }
+
+    const glm::vec2 *begin() const {
+        return _data;
+    }
+
+    const glm::vec2 *end() const {
+        return _data + _size;
+    }
+
+    bool isMapped() const {
+        return _mapping;
+    }
+
+private:
+    CachedProfile() = default;
+
+    ProfileKey _key;
+    const glm::vec2 *_data = nullptr;
+    size_t _size = 0;
+
+    std::vector<glm::vec2> _owned;
+    void *_mapping = nullptr;
+    size_t _mappingSize = 0;
+};
+
+// Write the profile to path in the binary cache format. The file is written
+// to a temporary name and then renamed so readers never see half written
+// files. Returns false on failure
+bool saveCachedProfile(const std::string &path, const CachedProfile &profile);
+
+// Profiles looked up in three layers: an in process least recently used list,
+// memory mapped files in a cache directory and finally computing the profile.
+// Safe to use from several threads
+class ProfileCache {
+public:
+    // Bump this whenever the profile generation changes, old files on disk are
+    // then ignored
+    static constexpr uint32_t fileVersion = 4;
+
+    // An empty directory disables the disk layer. The directory is created if
+    // it does not exist
+    explicit ProfileCache(std::string directory = {}, size_t capacity = 256);
+
+    std::shared_ptr<const CachedProfile> get(const GearSettings &settings,
+                                             ProfileSampling sampling = {});
+
+    struct Stats {
+        size_t memoryHits = 0;
+        size_t diskHits = 0;
+        size_t computed = 0;
+        // Computed profiles that could not be written to the directory
+        size_t writeFailures = 0;
+    };
+
+    Stats stats() const;
+
+    std::string path(const ProfileKey &key) const;
+
+private:
+    void insert(const ProfileKey &key,
+                std::shared_ptr<const CachedProfile> profile);
+
+    using ListT =
+        std::list<std::pair<ProfileKey, std::shared_ptr<const CachedProfile>>>;
+
+    std::string _directory;
+    size_t _capacity;
+
+    mutable std::mutex _mutex;
+    ListT _lru; // Most recently used first
+    std::unordered_map<ProfileKey, ListT::iterator, ProfileKeyHash> _lookup;
+    Stats _stats;
+};
@@ -0,0 +1,145 @@
+#include "profilegenerator.h"
+#include "standardgears.h"
+#include <algorithm>
+#include <cmath>
+#include <glm/gtc/constants.hpp>
+
+namespace {
+
+// Largest distance from the arc between flank points i and i + 1 to their
+// chord. The tangent of the involute at t points along (cos t, -sin t), so
+// on each side of the cusp the farthest point is where the tangent is
+// parallel to the chord
+float segmentDeviation(const GearSettings &settings,
+                       float from,
+                       float to,
+                       int i,
+                       const ProfileSampling &sampling) {
+    auto t1 = flankParameter(from, to, i, sampling);
+    auto t2 = flankParameter(from, to, i + 1, sampling);
+    auto p1 = settings.involuteProfile(t1);
+    auto p2 = settings.involuteProfile(t2);
+
+    auto chord = p2 - p1;
+    auto length = glm::length(chord);
+    if (length <= 0) {
+        return 0;
+    }
+    auto distance = [&](float t) {
+        auto d = settings.involuteProfile(t) - p1;
+        return std::abs(chord.x * d.y - chord.y * d.x) / length;
+    };
+
+    auto deviation = 0.f;
+    if (t1 < 0 && t2 > 0) {
+        deviation = distance(0);
+    }
+
+    // The tangent repeats every half turn
+    auto pi = glm::pi<float>();
+    auto parallel = -std::atan2(chord.y, chord.x);
+    parallel += pi * std::ceil((t1 - parallel) / pi);
+    for (auto t = parallel; t < t2; t += pi) {
+        deviation = std::max(deviation, distance(t));
+    }
+    return deviation;
+}
+
+} // namespace
+
+ProfileSampling ProfileSampling::adaptive(const GearSettings &settings,
+                                          float tolerance) {
+    auto from = settings.thresholdAngle(settings.clearingD);
+    auto to = settings.profileThresholdAngle(settings.addendumD);
+    auto r = settings.baseD / 2.f;
+
+    // Chord error for a step du in u = t^(3/2) is r * du^2 / 18. The
+    // branches below and above the cusp need whole steps each
+    auto du = std::sqrt(18.f * tolerance / r);
+    auto steps = std::ceil(std::pow(to, 1.5f) / du);
+    if (from < 0) {
+        steps += std::ceil(std::pow(-from, 1.5f) / du);
+    }
+
+    auto sampling = ProfileSampling{static_cast<int>(
+        std::clamp(steps, 1.f, static_cast<float>(maxAdaptiveSteps)))};
+    sampling.isAdaptive = true;
+
+    // The estimate ignores higher order terms, add steps until the
+    // tolerance is met
+    sampling.maxDeviation = flankDeviation(settings, sampling);
+    while (sampling.maxDeviation > tolerance &&
+           sampling.steps < maxAdaptiveSteps) {
+        sampling.steps = std::min(
+            sampling.steps + std::max(1, sampling.steps / 10),
+            maxAdaptiveSteps);
+        sampling.maxDeviation = flankDeviation(settings, sampling);
+    }
+
+    return sampling;
+}
+
+float flankDeviation(const GearSettings &settings, ProfileSampling sampling) {
+    auto from = settings.thresholdAngle(settings.clearingD);
+    auto to = settings.profileThresholdAngle(settings.addendumD);
+
+    float maxDeviation = 0;
+    for (int i = 0; i < sampling.steps; ++i) {
+        maxDeviation = std::max(
+            maxDeviation, segmentDeviation(settings, from, to, i, sampling));
+    }
+    return maxDeviation;
+}
+
+void generateHalfTooth(const GearSettings &settings,
+                       glm::vec2 *out,
+                       ProfileSampling sampling) {
+    if (auto baked = findStandardHalfTooth(settings, sampling)) {
+        std::copy(baked, baked + halfToothSize(sampling), out);
+        return;
+    }
+    forEachHalfToothPoint(
+        settings, sampling, [out](size_t i, glm::vec2 p) { out[i] = p; });
+}
+
+size_t generateProfile(const GearSettings &settings,
+                       glm::vec2 *out,
+                       size_t size,
+                       ProfileSampling sampling) {
+    auto total = profileSize(settings, sampling);
+    if (size < total) {
+        return 0;
+    }
+
+    auto n = halfToothSize(sampling);
+    auto toothSize = 2 * n;
+
+    // The first tooth is written directly: the mirrored half going outwards
+    // and the half tooth going back inwards
+    auto writeFirstTooth = [out, n](size_t i, glm::vec2 p) {
+        out[i] = {p.x, -p.y};
+        out[2 * n - 1 - i] = p;
+    };
+    if (auto baked = findStandardHalfTooth(settings, sampling)) {
+        for (size_t i = 0; i < n; ++i) {
+            writeFirstTooth(i, baked[i]);
+        }
+    }
+    else {
+        forEachHalfToothPoint(settings, sampling, writeFirstTooth);
+    }
+
+    for (int tooth = 1; tooth < settings.numTeeth; ++tooth) {
+        auto angle = glm::pi<float>() * 2.f * tooth / settings.numTeeth;
+        auto c = std::cos(angle);
+        auto s = std::sin(angle);
+        auto dst = out + tooth * toothSize;
+        for (size_t i = 0; i < toothSize; ++i) {
+            dst[i] = rotatedPoint(out[i], c, s);
+        }
+    }
+
+    out[total - 1] = out[0]; // Close loop
+
+    return total;
+}
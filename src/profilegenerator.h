@@ -0,0 +1,190 @@
+#pragma once
+
+#include "constmath.h"
+#include "gearsettings.h"
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <glm/glm.hpp>
+
+// Single pass profile generation
+//
+// The full profile is laid out tooth by tooth. Every tooth consists of the
+// mirrored half tooth going outwards followed by the half tooth going back
+// inwards, and the loop is closed by repeating the first point at the end
+//
+//   [m(h0) .. m(hn-1), hn-1 .. h0] * numTeeth, m(h0)
+//
+// where h0 is the point on the dedendum circle and h1..hn-1 the involute
+// flank
+
+constexpr int defaultProfileSteps = 20;
+
+// How the involute flank is divided into segments
+//
+// Uniform sampling spaces the points evenly in the involute parameter. The
+// adaptive sampling instead spaces them so that every chord deviates the same
+// amount from the curve: the radius of curvature of the involute is r * t, so
+// the chord error of a step dt is about r * t * dt^2 / 8, which is constant
+// for steps that are even in u = t^(3/2)
+//
+// The first point can be below the base circle. The involute is mirrored
+// there, with a cusp at t = 0, so the adaptive sampling places a point on the
+// cusp and samples the two branches separately
+struct ProfileSampling {
+    constexpr ProfileSampling(int steps = defaultProfileSteps)
+        : steps{steps} {}
+
+    // Use as few steps as possible while keeping the distance between the
+    // flank and the chords below tolerance (in the same unit as the module).
+    // Tolerances close to the float precision of the gear can not be
+    // reached, maxDeviation is then left above tolerance
+    static ProfileSampling adaptive(const GearSettings &settings,
+                                    float tolerance);
+
+    // Most steps that adaptive() uses
+    static constexpr int maxAdaptiveSteps = 10000;
+
+    // Number of segments on the flank
+    int steps = defaultProfileSteps;
+    bool isAdaptive = false;
+
+    // Largest distance between the flank and its chords, only set by
+    // adaptive(), see also flankDeviation()
+    float maxDeviation = 0;
+};
+
+// Number of points in a half tooth: the dedendum point and the flank
+constexpr size_t halfToothSize(ProfileSampling sampling = {}) {
+    return static_cast<size_t>(sampling.steps) + 2;
+}
+
+// Exact number of points written by generateProfile
+constexpr size_t profileSize(const GearSettings &settings,
+                             ProfileSampling sampling = {}) {
+    return static_cast<size_t>(settings.numTeeth) * 2 *
+               halfToothSize(sampling) +
+           1;
+}
+
+// Index of the flank point on the cusp at t = 0, or 0 if the flank is not
+// split there. Only adaptive sampling with at least one step on each side of
+// the cusp is split, and the steps are divided in proportion to u
+constexpr int flankSplit(float from,
+                         float to,
+                         const ProfileSampling &sampling) {
+    if (!sampling.isAdaptive || sampling.steps < 2 || from >= 0 || to <= 0) {
+        return 0;
+    }
+    auto below = constPow(-from, 1.5f);
+    auto above = constPow(to, 1.5f);
+    auto split =
+        static_cast<int>(sampling.steps * below / (below + above) + .5f);
+    return std::clamp(split, 1, sampling.steps - 1);
+}
+
+// Involute parameter for flank point i, where from and to are the parameters
+// of the first and the last point
+constexpr float flankParameter(float from,
+                               float to,
+                               int i,
+                               const ProfileSampling &sampling) {
+    auto amount = static_cast<float>(i) / sampling.steps;
+    if (!sampling.isAdaptive) {
+        return from + (to - from) * amount;
+    }
+
+    // Signed since the first point can be below the base circle
+    auto toU = [](float t) {
+        return constCopysign(constPow(constAbs(t), 1.5f), t);
+    };
+    auto toT = [](float u) { return constCopysign(constCbrt(u * u), u); };
+
+    auto u0 = toU(from);
+    auto u1 = toU(to);
+    auto split = flankSplit(from, to, sampling);
+    if (split == 0) {
+        return toT(u0 + (u1 - u0) * amount);
+    }
+    if (i <= split) {
+        return toT(u0 * static_cast<float>(split - i) / split);
+    }
+    return toT(u1 * static_cast<float>(i - split) / (sampling.steps - split));
+}
+
+constexpr glm::vec2 rotatedPoint(glm::vec2 p, float c, float s) {
+    return {c * p.x - s * p.y, s * p.x + c * p.y};
+}
+
+// Calculate each point of the half tooth and pass it to store(index, point)
+template <typename F>
+constexpr void forEachHalfToothPoint(const GearSettings &settings,
+                                     const ProfileSampling &sampling,
+                                     F store) {
+    auto from = settings.thresholdAngle(settings.clearingD);
+    auto to = settings.profileThresholdAngle(settings.addendumD);
+
+    auto angle = -settings.thresholdAngle(settings.pitchD) +
+                 settings.pitchAngle / 2.f / 2.f;
+    auto c = constCos(angle);
+    auto s = constSin(angle);
+
+    // Same as glm::normalize(first) * dedendumD / 2, which is used at run
+    // time to keep the result exactly as before
+    auto first =
+        settings.involuteProfile(flankParameter(from, to, 0, sampling));
+    auto root = glm::vec2{};
+    if (__builtin_is_constant_evaluated()) {
+        auto scale = 1.f / constSqrt(first.x * first.x + first.y * first.y);
+        root = {first.x * scale * settings.dedendumD / 2.f,
+                first.y * scale * settings.dedendumD / 2.f};
+    }
+    else {
+        root = glm::normalize(first) * settings.dedendumD / 2.f;
+    }
+    store(0, rotatedPoint(root, c, s));
+
+    for (auto i = 0; i <= sampling.steps; ++i) {
+        auto v =
+            settings.involuteProfile(flankParameter(from, to, i, sampling));
+        store(i + 1, rotatedPoint(v, c, s));
+    }
+}
+
+// Largest distance between the involute flank and the chords between the
+// sampled points
+float flankDeviation(const GearSettings &settings,
+                     ProfileSampling sampling = {});
+
+// Write the half tooth (rotated into place but not mirrored) into out, which
+// must have room for halfToothSize(sampling) points. Standard gears are
+// copied from the tables in standardgears.h
+void generateHalfTooth(const GearSettings &settings,
+                       glm::vec2 *out,
+                       ProfileSampling sampling = {});
+
+// Half tooth with uniform sampling computed at compile time, for example
+//
+//   constexpr auto table = halfToothTable<20>(GearSettings{30});
+//
+// Same layout as generateHalfTooth(). The points can differ from the run
+// time ones in the last bit since the compile time trigonometry is not the
+// one from the standard library
+template <int Steps = defaultProfileSteps>
+constexpr std::array<glm::vec2, halfToothSize(Steps)> halfToothTable(
+    const GearSettings &settings) {
+    auto table = std::array<glm::vec2, halfToothSize(Steps)>{};
+    forEachHalfToothPoint(
+        settings, ProfileSampling{Steps}, [&table](size_t i, glm::vec2 p) {
+            table[i] = p;
+        });
+    return table;
+}
+
+// Write the closed profile loop into out. size must be at least
+// profileSize(settings, sampling). No memory is allocated. Returns the number
+// of points written, or 0 if out is too small
+size_t generateProfile(const GearSettings &settings,
+                       glm::vec2 *out,
+                       size_t size,
+                       ProfileSampling sampling = {});
@@ -0,0 +1,373 @@
+#include "profilekernel.h"
+#include <algorithm>
+#include <cmath>
+#include <glm/gtc/constants.hpp>
+#include <vector>
+
+#if defined(__AVX__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// Each instruction set is wrapped in a struct with the same interface so the
+// kernels only needs to be written once
+
+struct ScalarOps {
+    using V = float;
+    using Mask = bool;
+    static constexpr size_t width = 1;
+    static constexpr const char *name = "scalar";
+
+    static V load(const float *p) {
+        return *p;
+    }
+    static void store(float *p, V v) {
+        *p = v;
+    }
+    static V set(float f) {
+        return f;
+    }
+    static V add(V a, V b) {
+        return a + b;
+    }
+    static V sub(V a, V b) {
+        return a - b;
+    }
+    static V mul(V a, V b) {
+        return a * b;
+    }
+    static V floor(V a) {
+        return std::floor(a);
+    }
+    static V abs(V a) {
+        return std::abs(a);
+    }
+    static Mask equal(V a, V b) {
+        return a == b;
+    }
+    static Mask less(V a, V b) {
+        return a < b;
+    }
+    static Mask orMask(Mask a, Mask b) {
+        return a || b;
+    }
+    static V select(Mask m, V a, V b) {
+        return m ? a : b;
+    }
+};
+
+#if defined(__SSE2__)
+
+struct SseOps {
+    using V = __m128;
+    using Mask = __m128;
+    static constexpr size_t width = 4;
+    static constexpr const char *name = "sse2";
+
+    static V load(const float *p) {
+        return _mm_loadu_ps(p);
+    }
+    static void store(float *p, V v) {
+        _mm_storeu_ps(p, v);
+    }
+    static V set(float f) {
+        return _mm_set1_ps(f);
+    }
+    static V add(V a, V b) {
+        return _mm_add_ps(a, b);
+    }
+    static V sub(V a, V b) {
+        return _mm_sub_ps(a, b);
+    }
+    static V mul(V a, V b) {
+        return _mm_mul_ps(a, b);
+    }
+    static V floor(V a) {
+        // Truncate and correct negative numbers, SSE2 has no round instruction
+        auto t = _mm_cvtepi32_ps(_mm_cvttps_epi32(a));
+        return _mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, a), _mm_set1_ps(1)));
+    }
+    static V abs(V a) {
+        return _mm_andnot_ps(_mm_set1_ps(-0.f), a);
+    }
+    static Mask equal(V a, V b) {
+        return _mm_cmpeq_ps(a, b);
+    }
+    static Mask less(V a, V b) {
+        return _mm_cmplt_ps(a, b);
+    }
+    static Mask orMask(Mask a, Mask b) {
+        return _mm_or_ps(a, b);
+    }
+    static V select(Mask m, V a, V b) {
+        return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b));
+    }
+};
+
+#endif
+
+#if defined(__AVX__)
+
+struct AvxOps {
+    using V = __m256;
+    using Mask = __m256;
+    static constexpr size_t width = 8;
+    static constexpr const char *name = "avx";
+
+    static V load(const float *p) {
+        return _mm256_loadu_ps(p);
+    }
+    static void store(float *p, V v) {
+        _mm256_storeu_ps(p, v);
+    }
+    static V set(float f) {
+        return _mm256_set1_ps(f);
+    }
+    static V add(V a, V b) {
+        return _mm256_add_ps(a, b);
+    }
+    static V sub(V a, V b) {
+        return _mm256_sub_ps(a, b);
+    }
+    static V mul(V a, V b) {
+        return _mm256_mul_ps(a, b);
+    }
+    static V floor(V a) {
+        return _mm256_floor_ps(a);
+    }
+    static V abs(V a) {
+        return _mm256_andnot_ps(_mm256_set1_ps(-0.f), a);
+    }
+    static Mask equal(V a, V b) {
+        return _mm256_cmp_ps(a, b, _CMP_EQ_OQ);
+    }
+    static Mask less(V a, V b) {
+        return _mm256_cmp_ps(a, b, _CMP_LT_OQ);
+    }
+    static Mask orMask(Mask a, Mask b) {
+        return _mm256_or_ps(a, b);
+    }
+    static V select(Mask m, V a, V b) {
+        return _mm256_blendv_ps(b, a, m);
+    }
+};
+
+using Ops = AvxOps;
+
+#elif defined(__SSE2__)
+
+using Ops = SseOps;
+
+#else
+
+using Ops = ScalarOps;
+
+#endif
+
+// Sine and cosine with the single precision polynomials from the cephes
+// library. Quadrant selection is done with floating point math so that it
+// works the same for all instruction sets
+template <typename O>
+void sincos(typename O::V x, typename O::V &sinOut, typename O::V &cosOut) {
+    auto ax = O::abs(x);
+
+    // Octant, rounded up to an even number
+    auto j = O::floor(O::mul(ax, O::set(4.f / glm::pi<float>())));
+    auto odd = O::sub(j, O::mul(O::set(2), O::floor(O::mul(j, O::set(.5f)))));
+    j = O::add(j, odd);
+
+    // Extended precision reduction into [-pi/4, pi/4]
+    auto xr = O::sub(ax, O::mul(j, O::set(0.78515625f)));
+    xr = O::sub(xr, O::mul(j, O::set(2.4187564849853515625e-4f)));
+    xr = O::sub(xr, O::mul(j, O::set(3.77489497744594108e-8f)));
+
+    // j modulo 8 is one of 0, 2, 4, 6
+    j = O::sub(j, O::mul(O::set(8), O::floor(O::mul(j, O::set(.125f)))));
+
+    auto z = O::mul(xr, xr);
+
+    auto polyCos = O::mul(O::set(2.443315711809948e-5f), z);
+    polyCos = O::mul(O::add(polyCos, O::set(-1.388731625493765e-3f)), z);
+    polyCos = O::mul(O::add(polyCos, O::set(4.166664568298827e-2f)), z);
+    polyCos = O::mul(polyCos, z);
+    polyCos = O::sub(polyCos, O::mul(O::set(.5f), z));
+    polyCos = O::add(polyCos, O::set(1));
+
+    auto polySin = O::mul(O::set(-1.9515295891e-4f), z);
+    polySin = O::mul(O::add(polySin, O::set(8.3321608736e-3f)), z);
+    polySin = O::mul(O::add(polySin, O::set(-1.6666654611e-1f)), z);
+    polySin = O::add(O::mul(polySin, xr), xr);
+
+    auto swap = O::orMask(O::equal(j, O::set(2)), O::equal(j, O::set(6)));
+    auto s = O::select(swap, polyCos, polySin);
+    auto c = O::select(swap, polySin, polyCos);
+
+    auto zero = O::set(0);
+    auto negS = O::less(O::set(3), j);
+    s = O::select(negS, O::sub(zero, s), s);
+    s = O::select(O::less(x, zero), O::sub(zero, s), s);
+
+    auto negC = O::orMask(O::equal(j, O::set(2)), O::equal(j, O::set(4)));
+    c = O::select(negC, O::sub(zero, c), c);
+
+    sinOut = s;
+    cosOut = c;
+}
+
+template <typename O>
+void involute(const GearSettings &settings,
+              const float *angles,
+              float *x,
+              float *y,
+              size_t i) {
+    auto r = O::set(settings.baseD / 2.f);
+    auto a = O::load(angles + i);
+    auto s = typename O::V{};
+    auto c = typename O::V{};
+    sincos<O>(a, s, c);
+    auto ra = O::mul(r, a);
+    O::store(x + i, O::add(O::mul(r, c), O::mul(ra, s)));
+    O::store(y + i, O::sub(O::mul(ra, c), O::mul(r, s)));
+}
+
+template <typename O>
+void transform(const float *x,
+               const float *y,
+               float *outX,
+               float *outY,
+               size_t i,
+               float c,
+               float s,
+               glm::vec2 offset,
+               bool mirror) {
+    auto px = O::load(x + i);
+    auto py = O::load(y + i);
+    if (mirror) {
+        py = O::sub(O::set(0), py);
+    }
+    auto rx = O::sub(O::mul(O::set(c), px), O::mul(O::set(s), py));
+    auto ry = O::add(O::mul(O::set(s), px), O::mul(O::set(c), py));
+    O::store(outX + i, O::add(rx, O::set(offset.x)));
+    O::store(outY + i, O::add(ry, O::set(offset.y)));
+}
+
+} // namespace
+
+const char *profileKernelInstructionSet() {
+    return Ops::name;
+}
+
+void involuteBatch(const GearSettings &settings,
+                   const float *angles,
+                   float *x,
+                   float *y,
+                   size_t n) {
+    size_t i = 0;
+    for (; i + Ops::width <= n; i += Ops::width) {
+        involute<Ops>(settings, angles, x, y, i);
+    }
+    for (; i < n; ++i) {
+        involute<ScalarOps>(settings, angles, x, y, i);
+    }
+}
+
+void transformBatch(const float *x,
+                    const float *y,
+                    float *outX,
+                    float *outY,
+                    size_t n,
+                    float angle,
+                    glm::vec2 offset,
+                    bool mirror) {
+    auto c = std::cos(angle);
+    auto s = std::sin(angle);
+    size_t i = 0;
+    for (; i + Ops::width <= n; i += Ops::width) {
+        transform<Ops>(x, y, outX, outY, i, c, s, offset, mirror);
+    }
+    for (; i < n; ++i) {
+        transform<ScalarOps>(x, y, outX, outY, i, c, s, offset, mirror);
+    }
+}
+
+size_t generateProfileSoA(const GearSettings &settings,
+                          float *x,
+                          float *y,
+                          size_t size,
+                          ProfileSampling sampling) {
+    auto total = profileSize(settings, sampling);
+    if (size < total) {
+        return 0;
+    }
+
+    auto n = halfToothSize(sampling);
+    auto toothSize = 2 * n;
+
+    auto from = settings.thresholdAngle(settings.clearingD);
+    auto to = settings.profileThresholdAngle(settings.addendumD);
+
+    // Flank in the first half of the first tooth, in chunks so that the
+    // angles fit on the stack
+    constexpr size_t chunkSize = 64;
+    float angles[chunkSize];
+    auto numFlank = static_cast<size_t>(sampling.steps) + 1;
+    for (size_t begin = 0; begin < numFlank; begin += chunkSize) {
+        auto count = std::min(chunkSize, numFlank - begin);
+        for (size_t i = 0; i < count; ++i) {
+            angles[i] = flankParameter(
+                from, to, static_cast<int>(begin + i), sampling);
+        }
+        involuteBatch(settings, angles, x + 1 + begin, y + 1 + begin, count);
+    }
+
+    auto first =
+        glm::normalize(glm::vec2{x[1], y[1]}) * settings.dedendumD / 2.f;
+    x[0] = first.x;
+    y[0] = first.y;
+
+    transformBatch(x,
+                   y,
+                   x,
+                   y,
+                   n,
+                   -settings.thresholdAngle(settings.pitchD) +
+                       settings.pitchAngle / 2.f / 2.f);
+
+    // Second half of the tooth is the half tooth backwards, the first half is
+    // the mirror image
+    for (size_t i = 0; i < n; ++i) {
+        x[toothSize - 1 - i] = x[i];
+        y[toothSize - 1 - i] = y[i];
+    }
+    transformBatch(x, y, x, y, n, 0, {}, true);
+
+    for (int tooth = 1; tooth < settings.numTeeth; ++tooth) {
+        auto angle = glm::pi<float>() * 2.f * tooth / settings.numTeeth;
+        auto offset = tooth * toothSize;
+        transformBatch(x, y, x + offset, y + offset, toothSize, angle);
+    }
+
+    x[total - 1] = x[0]; // Close loop
+    y[total - 1] = y[0];
+
+    return total;
+}
+
+float verifyProfileKernel(const GearSettings &settings,
+                          ProfileSampling sampling) {
+    auto size = profileSize(settings, sampling);
+    auto reference = std::vector<glm::vec2>(size);
+    auto x = std::vector<float>(size);
+    auto y = std::vector<float>(size);
+
+    generateProfile(settings, reference.data(), size, sampling);
+    generateProfileSoA(settings, x.data(), y.data(), size, sampling);
+
+    float maxError = 0;
+    for (size_t i = 0; i < size; ++i) {
+        auto p = glm::vec2{x.at(i), y.at(i)};
+        maxError = std::max(maxError, glm::distance(reference.at(i), p));
+    }
+    return maxError;
+}
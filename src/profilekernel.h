@@ -0,0 +1,54 @@
+#pragma once
+
+#include "gearsettings.h"
+#include "profilegenerator.h"
+#include <cstddef>
+#include <glm/glm.hpp>
+
+// Vectorized structure of arrays versions of the profile math
+//
+// Points are stored as separate x and y arrays. Uses AVX or SSE2 when the
+// compiler targets them (see the INVOLUTE_NATIVE cmake option) and falls back
+// to plain scalar code otherwise. Sine and cosine are evaluated with a
+// polynomial approximation, so results are not bit identical to the scalar
+// path, see verifyProfileKernel()
+//
+// The kernels are a reference and benchmark for the vectorized math and are
+// not used to draw or export gears. generateProfile() stays on the scalar
+// path: the rest of the library wants interleaved points, and the baked
+// standard gears already skip most of the involute evaluation
+
+// Name of the instruction set the kernels were compiled for
+const char *profileKernelInstructionSet();
+
+// x[i], y[i] = settings.involuteProfile(angles[i])
+void involuteBatch(const GearSettings &settings,
+                   const float *angles,
+                   float *x,
+                   float *y,
+                   size_t n);
+
+// Rotate points around origin and then translate them by offset. If mirror
+// is set y is negated before rotating. Input and output may be the same arrays
+void transformBatch(const float *x,
+                    const float *y,
+                    float *outX,
+                    float *outY,
+                    size_t n,
+                    float angle,
+                    glm::vec2 offset = {},
+                    bool mirror = false);
+
+// Same layout as generateProfile() but with separate x and y arrays. All
+// tooth copies are created from the first tooth. Returns number of points
+// written or 0 if the arrays are too small
+size_t generateProfileSoA(const GearSettings &settings,
+                          float *x,
+                          float *y,
+                          size_t size,
+                          ProfileSampling sampling = {});
+
+// Largest distance between a point from generateProfileSoA() and the same
+// point from generateProfile()
+float verifyProfileKernel(const GearSettings &settings,
+                          ProfileSampling sampling = {});
@@ -0,0 +1,42 @@
+#include "profilepyramid.h"
+#include <algorithm>
+
+ProfilePyramid::ProfilePyramid(const GearSettings &settings,
+                               ProfileSampling sampling) {
+    auto steps = std::max(1, sampling.steps);
+    for (;;) {
+        auto levelSampling = ProfileSampling{steps};
+        levelSampling.isAdaptive = sampling.isAdaptive;
+        levels.push_back({CompactProfile{settings, levelSampling}, {}});
+        if (steps == 1) {
+            break;
+        }
+        steps = (steps + 1) / 2;
+    }
+
+    // The profiles were calculated by their constructors
+    for (auto &level : levels) {
+        level.maxDeviation =
+            flankDeviation(level.profile.settings, level.profile.sampling);
+    }
+    computeMeshes();
+}
+
+void ProfilePyramid::computeMeshes() {
+    for (auto &level : levels) {
+        level.mesh = triangulateProfile(level.profile);
+    }
+}
+
+const ProfilePyramid::Level &ProfilePyramid::level(float pixelsPerUnit,
+                                                   float tolerance) const {
+    // Halving the steps moves the points, so the deviation does not always
+    // grow from one level to the next and every level is checked. Falls back
+    // to the finest level
+    for (auto i = levels.size(); i-- > 1;) {
+        if (levels[i].maxDeviation * pixelsPerUnit <= tolerance) {
+            return levels[i];
+        }
+    }
+    return levels.front();
+}
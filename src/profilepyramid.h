@@ -0,0 +1,36 @@
+#pragma once
+
+#include "compactprofile.h"
+#include "gearmesh.h"
+#include "gearsettings.h"
+#include "profilegenerator.h"
+#include <vector>
+
+// Versions of the same gear profile with fewer and fewer flank steps, for
+// drawing gears that are small on screen
+//
+// Level 0 has the steps of the sampling it was created with, and every
+// following level has half the steps of the previous one, down to a single
+// step. Every level has its own mesh
+struct ProfilePyramid {
+    struct Level {
+        CompactProfile profile;
+        GearMesh mesh;
+
+        // Largest distance between the flank and its chords, in the unit of
+        // the module
+        float maxDeviation = 0;
+    };
+
+    ProfilePyramid(const GearSettings &settings,
+                   ProfileSampling sampling = {});
+
+    void computeMeshes();
+
+    // The coarsest level whose chords stay within tolerance pixels of the
+    // flanks when drawn with pixelsPerUnit
+    const Level &level(float pixelsPerUnit, float tolerance = .5f) const;
+
+    // Finest first
+    std::vector<Level> levels;
+};
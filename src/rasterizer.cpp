@@ -0,0 +1,258 @@
+#include "rasterizer.h"
+#include "threadpool.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+constexpr int tileSize = 64;
+
+// A segment that touches a tile
+struct TileEntry {
+    uint32_t stroke;
+    // Index of the first point of the segment
+    uint32_t segment;
+};
+
+// Segments sorted by tile, in the order they are drawn
+struct TileBins {
+    int numX = 0;
+    int numY = 0;
+    std::vector<uint32_t> offsets;
+    std::vector<TileEntry> entries;
+};
+
+struct TileRange {
+    int x0;
+    int y0;
+    int x1;
+    int y1;
+};
+
+// Tiles covered by the segment, including the anti-aliased edge. Returns
+// false if it is outside the image
+bool segmentTiles(glm::vec2 p1,
+                  glm::vec2 p2,
+                  float radius,
+                  const Image &image,
+                  const TileBins &bins,
+                  TileRange &range) {
+    auto min = glm::min(p1, p2) - glm::vec2{radius, radius};
+    auto max = glm::max(p1, p2) + glm::vec2{radius, radius};
+    if (!(max.x >= 0 && max.y >= 0 && min.x < image.width &&
+          min.y < image.height)) {
+        // Also catches nan
+        return false;
+    }
+    // Clamp before converting, points can be far outside the image
+    min = glm::max(min, glm::vec2{0, 0});
+    max = glm::min(max, glm::vec2{image.width - 1, image.height - 1});
+    range.x0 = static_cast<int>(min.x) / tileSize;
+    range.y0 = static_cast<int>(min.y) / tileSize;
+    range.x1 = std::min(bins.numX - 1, static_cast<int>(max.x) / tileSize);
+    range.y1 = std::min(bins.numY - 1, static_cast<int>(max.y) / tileSize);
+    return true;
+}
+
+// Counting sort of all segments into the tiles they touch, two passes so
+// that the result is one allocation
+void binSegments(const RasterScene &scene, const Image &image, TileBins &bins) {
+    bins.numX = (image.width + tileSize - 1) / tileSize;
+    bins.numY = (image.height + tileSize - 1) / tileSize;
+    auto numTiles = static_cast<size_t>(bins.numX) * bins.numY;
+    bins.offsets.assign(numTiles + 1, 0);
+
+    auto &points = scene.points();
+    auto &strokes = scene.strokes();
+
+    auto forEachSegment = [&](auto f) {
+        for (uint32_t s = 0; s < strokes.size(); ++s) {
+            auto &stroke = strokes[s];
+            auto radius = stroke.halfWidth + 1;
+            for (auto i = stroke.first; i + 1 < stroke.last; ++i) {
+                auto range = TileRange{};
+                if (!segmentTiles(
+                        points[i], points[i + 1], radius, image, bins, range)) {
+                    continue;
+                }
+                for (int y = range.y0; y <= range.y1; ++y) {
+                    for (int x = range.x0; x <= range.x1; ++x) {
+                        f(static_cast<size_t>(y) * bins.numX + x,
+                          TileEntry{s, i});
+                    }
+                }
+            }
+        }
+    };
+
+    forEachSegment([&](size_t tile, TileEntry) { ++bins.offsets[tile + 1]; });
+    for (size_t i = 0; i < numTiles; ++i) {
+        bins.offsets[i + 1] += bins.offsets[i];
+    }
+    bins.entries.resize(bins.offsets.back());
+
+    auto fill = std::vector<uint32_t>(bins.offsets.begin(),
+                                      bins.offsets.end() - 1);
+    forEachSegment([&](size_t tile, TileEntry entry) {
+        bins.entries[fill[tile]++] = entry;
+    });
+}
+
+float segmentDistance(glm::vec2 p, glm::vec2 a, glm::vec2 ab, float lengthSq) {
+    auto t = lengthSq > 0 ? glm::clamp(glm::dot(p - a, ab) / lengthSq, 0.f, 1.f)
+                          : 0.f;
+    return glm::distance(p, a + ab * t);
+}
+
+void drawTile(const RasterScene &scene,
+              const TileEntry *begin,
+              const TileEntry *end,
+              int tileX,
+              int tileY,
+              Image &image) {
+    auto x0 = tileX * tileSize;
+    auto y0 = tileY * tileSize;
+    auto w = std::min(tileSize, image.width - x0);
+    auto h = std::min(tileSize, image.height - y0);
+    auto origin = glm::vec2{x0, y0};
+
+    auto background = scene.background();
+    float color[tileSize * tileSize][3];
+    float coverage[tileSize * tileSize] = {};
+    for (auto &c : color) {
+        c[0] = background.r;
+        c[1] = background.g;
+        c[2] = background.b;
+    }
+
+    auto &points = scene.points();
+    auto &strokes = scene.strokes();
+
+    for (auto entry = begin; entry != end;) {
+        // Coverage is the max over all segments of a stroke, so that joints
+        // are not blended twice
+        auto strokeIndex = entry->stroke;
+        auto &stroke = strokes[strokeIndex];
+        auto radius = stroke.halfWidth + .5f;
+
+        auto minX = w;
+        auto minY = h;
+        auto maxX = -1;
+        auto maxY = -1;
+
+        for (; entry != end && entry->stroke == strokeIndex; ++entry) {
+            auto a = points[entry->segment] - origin;
+            auto b = points[entry->segment + 1] - origin;
+            auto ab = b - a;
+            auto lengthSq = glm::dot(ab, ab);
+
+            auto min = glm::max(glm::min(a, b) - glm::vec2{radius, radius},
+                                glm::vec2{0, 0});
+            auto max = glm::min(glm::max(a, b) + glm::vec2{radius, radius},
+                                glm::vec2{w - 1, h - 1});
+            if (min.x > max.x || min.y > max.y) {
+                continue;
+            }
+            auto bx0 = static_cast<int>(min.x);
+            auto by0 = static_cast<int>(min.y);
+            auto bx1 = static_cast<int>(max.x);
+            auto by1 = static_cast<int>(max.y);
+
+            minX = std::min(minX, bx0);
+            minY = std::min(minY, by0);
+            maxX = std::max(maxX, bx1);
+            maxY = std::max(maxY, by1);
+
+            for (auto y = by0; y <= by1; ++y) {
+                for (auto x = bx0; x <= bx1; ++x) {
+                    auto d = segmentDistance(
+                        glm::vec2{x + .5f, y + .5f}, a, ab, lengthSq);
+                    auto &c = coverage[y * tileSize + x];
+                    c = std::max(c, glm::clamp(radius - d, 0.f, 1.f));
+                }
+            }
+        }
+
+        auto alpha = stroke.color.a / 255.f;
+        for (auto y = minY; y <= maxY; ++y) {
+            for (auto x = minX; x <= maxX; ++x) {
+                auto &c = coverage[y * tileSize + x];
+                auto amount = c * alpha;
+                auto &pixel = color[y * tileSize + x];
+                pixel[0] += (stroke.color.r - pixel[0]) * amount;
+                pixel[1] += (stroke.color.g - pixel[1]) * amount;
+                pixel[2] += (stroke.color.b - pixel[2]) * amount;
+                c = 0;
+            }
+        }
+    }
+
+    for (auto y = 0; y < h; ++y) {
+        auto out = image.pixels.data() +
+                   (static_cast<size_t>(y0 + y) * image.width + x0) * 4;
+        for (auto x = 0; x < w; ++x) {
+            auto &pixel = color[y * tileSize + x];
+            out[0] = static_cast<uint8_t>(pixel[0] + .5f);
+            out[1] = static_cast<uint8_t>(pixel[1] + .5f);
+            out[2] = static_cast<uint8_t>(pixel[2] + .5f);
+            out[3] = 255;
+            out += 4;
+        }
+    }
+}
+
+} // namespace
+
+void RasterScene::clear(Color background) {
+    _background = background;
+    _points.clear();
+    _strokes.clear();
+}
+
+void RasterScene::drawLine(glm::vec2 p1,
+                           glm::vec2 p2,
+                           Color color,
+                           float width) {
+    auto first = static_cast<uint32_t>(_points.size());
+    _points.push_back(p1);
+    _points.push_back(p2);
+    _strokes.push_back({first, first + 2, color, width / 2});
+}
+
+void RasterScene::drawLines(const std::vector<glm::vec2> &points,
+                            Color color,
+                            float width) {
+    auto first = static_cast<uint32_t>(_points.size());
+    _points.insert(_points.end(), points.begin(), points.end());
+    _strokes.push_back({first,
+                        static_cast<uint32_t>(_points.size()),
+                        color,
+                        width / 2});
+}
+
+void rasterize(const RasterScene &scene, Image &image, ThreadPool *pool) {
+    // Kept per thread, so that rendering many frames does not allocate. The
+    // workers must use the bins of this thread, not their own
+    thread_local auto threadBins = TileBins{};
+    auto &bins = threadBins;
+    binSegments(scene, image, bins);
+
+    auto drawTileIndex = [&](size_t tile) {
+        drawTile(scene,
+                 bins.entries.data() + bins.offsets[tile],
+                 bins.entries.data() + bins.offsets[tile + 1],
+                 static_cast<int>(tile % bins.numX),
+                 static_cast<int>(tile / bins.numX),
+                 image);
+    };
+
+    auto numTiles = static_cast<size_t>(bins.numX) * bins.numY;
+    if (pool) {
+        pool->parallelFor(numTiles, drawTileIndex);
+    }
+    else {
+        for (size_t tile = 0; tile < numTiles; ++tile) {
+            drawTileIndex(tile);
+        }
+    }
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "color.h"
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <vector>
+
+class ThreadPool;
+
+// 8 bit RGBA pixels, rows from the top
+struct Image {
+    Image(int width = 0, int height = 0)
+        : width{width}
+        , height{height}
+        , pixels(static_cast<size_t>(width) * height * 4) {}
+
+    int width;
+    int height;
+    std::vector<uint8_t> pixels;
+};
+
+// Polylines to rasterize, in pixel coordinates. Strokes are drawn in the
+// order they are added
+class RasterScene {
+public:
+    struct Stroke {
+        // Range of points in points()
+        uint32_t first;
+        uint32_t last;
+        Color color;
+        float halfWidth;
+    };
+
+    // Remove all strokes and set the background, keeps the memory
+    void clear(Color background);
+
+    void drawLine(glm::vec2 p1, glm::vec2 p2, Color color, float width = 1);
+
+    // Connected segments through all points, same as SDL_RenderDrawLinesF
+    void drawLines(const std::vector<glm::vec2> &points,
+                   Color color,
+                   float width = 1);
+
+    Color background() const {
+        return _background;
+    }
+
+    const std::vector<glm::vec2> &points() const {
+        return _points;
+    }
+
+    const std::vector<Stroke> &strokes() const {
+        return _strokes;
+    }
+
+private:
+    Color _background = {};
+    std::vector<glm::vec2> _points;
+    std::vector<Stroke> _strokes;
+};
+
+// Draw the scene into image with anti-aliased lines
+//
+// The image is split into square tiles and every segment is sorted into the
+// tiles it touches, so that each tile can be drawn on its own. With a pool
+// the tiles are spread over the threads, without one everything runs on the
+// calling thread (use that when rendering several frames in parallel)
+void rasterize(const RasterScene &scene,
+               Image &image,
+               ThreadPool *pool = nullptr);
@@ -0,0 +1,59 @@
+#include "settingsio.h"
+#include <istream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+GearSettings makeGearSettings(int numTeeth, int module, float preassureAngle) {
+    return GearSettings{
+        .numTeeth = numTeeth,
+        .module = module,
+        .preassureAngle = preassureAngle,
+    };
+}
+
+std::vector<GearSettings> readSettingsList(std::istream &in) {
+    auto list = std::vector<GearSettings>{};
+
+    int lineNumber = 0;
+    for (std::string line; std::getline(in, line);) {
+        ++lineNumber;
+        if (auto comment = line.find('#'); comment != std::string::npos) {
+            line.erase(comment);
+        }
+
+        auto ss = std::istringstream{line};
+        int numTeeth = 0;
+        int module = 0;
+        float preassureAngle = 20;
+
+        if (!(ss >> numTeeth)) {
+            if (line.find_first_not_of(" \t\r") == std::string::npos) {
+                continue;
+            }
+            throw std::runtime_error{"line " + std::to_string(lineNumber) +
+                                     ": expected number of teeth"};
+        }
+        if (!(ss >> module)) {
+            throw std::runtime_error{"line " + std::to_string(lineNumber) +
+                                     ": expected module"};
+        }
+        if (!(ss >> preassureAngle)) {
+            if (!ss.eof()) {
+                throw std::runtime_error{"line " + std::to_string(lineNumber) +
+                                         ": bad pressure angle"};
+            }
+            preassureAngle = 20;
+        }
+
+        if (numTeeth < 3 || module < 1 || preassureAngle <= 0 ||
+            preassureAngle >= 45) {
+            throw std::runtime_error{"line " + std::to_string(lineNumber) +
+                                     ": gear parameters out of range"};
+        }
+
+        list.push_back(makeGearSettings(numTeeth, module, preassureAngle));
+    }
+
+    return list;
+}
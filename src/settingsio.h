@@ -0,0 +1,14 @@
+#pragma once
+
+#include "gearsettings.h"
+#include <iosfwd>
+#include <vector>
+
+// Create settings from the input parameters and calculate the derived values
+GearSettings makeGearSettings(int numTeeth, int module, float preassureAngle);
+
+// Read one gear per line on the form
+//   numTeeth module preassureAngle
+// Pressure angle is optional and defaults to 20 degrees. Empty lines and
+// everything after '#' is ignored. Throws std::runtime_error on bad input
+std::vector<GearSettings> readSettingsList(std::istream &in);
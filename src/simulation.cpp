@@ -0,0 +1,109 @@
+#include "simulation.h"
+#include <algorithm>
+
+Simulation::Simulation(size_t numGears, SolveT solve)
+    : _solve{std::move(solve)}
+    , _state{initialState(numGears, _solve)}
+    , _buffer{Published{_state, _state}}
+    , _start{std::chrono::steady_clock::now()}
+    , _thread{[this] { run(); }} {}
+
+SimulationState Simulation::initialState(size_t numGears,
+                                         const SolveT &solve) {
+    auto state = SimulationState{};
+    state.angles.resize(numGears);
+    solve(state.driverAngle, state.angles);
+    return state;
+}
+
+Simulation::~Simulation() {
+    _isRunning = false;
+    _thread.join();
+}
+
+void Simulation::animate(bool shouldAnimate) {
+    _isAnimating = shouldAnimate;
+}
+
+bool Simulation::isAnimating() const {
+    return _isAnimating;
+}
+
+void Simulation::speed(float radiansPerSecond) {
+    _speed = radiansPerSecond;
+}
+
+void Simulation::driverAngle(float angle) {
+    _requestedAngle = angle;
+    _hasRequestedAngle = true;
+}
+
+void Simulation::interpolate(std::vector<float> &angles) {
+    _buffer.update();
+    auto &published = _buffer.front();
+    auto &previous = published.previous;
+    auto &current = published.current;
+
+    // The latest tick is shown when its time has passed, so the displayed
+    // state is always one tick behind, but never needs to be extrapolated
+    auto now = std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                             _start)
+                   .count();
+    auto amount = static_cast<float>(
+        std::clamp((now - current.time) / timeStep, 0., 1.));
+
+    angles.resize(current.angles.size());
+    for (size_t i = 0; i < angles.size(); ++i) {
+        auto from = i < previous.angles.size() ? previous.angles[i]
+                                               : current.angles[i];
+        angles[i] = from + (current.angles[i] - from) * amount;
+    }
+}
+
+void Simulation::step(double time) {
+    _state.time = time;
+
+    if (_hasRequestedAngle.exchange(false)) {
+        _state.driverAngle = _requestedAngle;
+    }
+    else if (_isAnimating) {
+        _state.driverAngle += _speed * static_cast<float>(timeStep);
+    }
+
+    _solve(_state.driverAngle, _state.angles);
+}
+
+void Simulation::run() {
+    using namespace std::chrono;
+
+    auto step =
+        duration_cast<steady_clock::duration>(duration<double>{timeStep});
+
+    // Never try to catch up more than this many ticks after a stall
+    constexpr int maxCatchUp = 30;
+
+    auto next = _start + step;
+    for (; _isRunning;) {
+        std::this_thread::sleep_until(next);
+
+        // Run all ticks that are due, so the speed stays exact even if the
+        // thread was delayed
+        int numTicks = 0;
+        auto now = steady_clock::now();
+        for (; next <= now && numTicks < maxCatchUp; next += step, ++numTicks) {
+            auto &back = _buffer.back();
+            back.previous = _state;
+            this->step(duration<double>(next - _start).count());
+            back.current = _state;
+        }
+
+        if (numTicks == maxCatchUp) {
+            // Give up on catching up
+            next = steady_clock::now() + step;
+        }
+
+        if (numTicks) {
+            _buffer.publish();
+        }
+    }
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "triplebuffer.h"
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <thread>
+#include <vector>
+
+// Angles of all gears at one simulation tick
+struct SimulationState {
+    // Seconds since the simulation started, always a whole number of ticks
+    double time = 0;
+    float driverAngle = 0;
+    std::vector<float> angles;
+};
+
+// Gear kinematics running on its own thread with a fixed time step
+//
+// The driver angle advances with a constant speed while animating, and every
+// tick the angles of all gears are calculated from it with the solve
+// function. Finished ticks are handed to the render thread through a triple
+// buffer, and the render thread interpolates between the two latest ticks so
+// that motion is smooth and independent of the frame rate
+class Simulation {
+public:
+    // Calculate the angle for every gear from the angle of the driving gear.
+    // Called on the simulation thread
+    using SolveT = std::function<void(float driverAngle,
+                                      std::vector<float> &angles)>;
+
+    static constexpr double timeStep = 1. / 120.;
+
+    Simulation(size_t numGears, SolveT solve);
+
+    Simulation(const Simulation &) = delete;
+    Simulation &operator=(const Simulation &) = delete;
+
+    ~Simulation();
+
+    // Thread safe controls
+    void animate(bool shouldAnimate);
+    bool isAnimating() const;
+
+    // Radians per second for the driving gear
+    void speed(float radiansPerSecond);
+
+    // Move the driving gear to angle (used for manual control)
+    void driverAngle(float angle);
+
+    // Render thread: angles interpolated for the current time. The memory in
+    // angles is reused
+    void interpolate(std::vector<float> &angles);
+
+private:
+    struct Published {
+        SimulationState previous;
+        SimulationState current;
+    };
+
+    static SimulationState initialState(size_t numGears, const SolveT &solve);
+
+    void run();
+    void step(double time);
+
+    SolveT _solve;
+
+    std::atomic<bool> _isRunning{true};
+    std::atomic<bool> _isAnimating{false};
+    std::atomic<float> _speed{.4f};
+    std::atomic<float> _requestedAngle{0};
+    std::atomic<bool> _hasRequestedAngle{false};
+
+    // Only touched by the simulation thread
+    SimulationState _state;
+
+    TripleBuffer<Published> _buffer;
+    std::chrono::steady_clock::time_point _start;
+
+    std::thread _thread;
+};
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "gearsettings.h"
+#include "profilegenerator.h"
+#include <array>
+#include <cstddef>
+#include <glm/glm.hpp>
+
+// Half teeth of the standard gears (module 1, 20 degrees, uniform sampling
+// with the default number of steps), computed by the compiler and stored in
+// the binary so nothing has to be generated at startup
+//
+// Expand them with the tooth rotations of CompactProfile::rotation()
+
+template <int NumTeeth>
+inline constexpr auto standardHalfTooth =
+    halfToothTable(GearSettings{NumTeeth});
+
+struct StandardGear {
+    GearSettings settings;
+
+    // halfToothSize() points, see generateHalfTooth()
+    const glm::vec2 *halfTooth;
+};
+
+inline constexpr auto standardGears = std::array<StandardGear, 12>{{
+    {GearSettings{8}, standardHalfTooth<8>.data()},
+    {GearSettings{10}, standardHalfTooth<10>.data()},
+    {GearSettings{12}, standardHalfTooth<12>.data()},
+    {GearSettings{15}, standardHalfTooth<15>.data()},
+    {GearSettings{16}, standardHalfTooth<16>.data()},
+    {GearSettings{20}, standardHalfTooth<20>.data()},
+    {GearSettings{24}, standardHalfTooth<24>.data()},
+    {GearSettings{30}, standardHalfTooth<30>.data()},
+    {GearSettings{32}, standardHalfTooth<32>.data()},
+    {GearSettings{40}, standardHalfTooth<40>.data()},
+    {GearSettings{48}, standardHalfTooth<48>.data()},
+    {GearSettings{60}, standardHalfTooth<60>.data()},
+}};
+
+// The baked half tooth for settings, or nullptr if it is not a standard gear
+constexpr const glm::vec2 *findStandardHalfTooth(
+    const GearSettings &settings,
+    ProfileSampling sampling = {}) {
+    if (sampling.isAdaptive || sampling.steps != defaultProfileSteps) {
+        return nullptr;
+    }
+    for (auto &gear : standardGears) {
+        if (gear.settings.numTeeth == settings.numTeeth &&
+            gear.settings.module == settings.module &&
+            gear.settings.preassureAngle == settings.preassureAngle) {
+            return gear.halfTooth;
+        }
+    }
+    return nullptr;
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+// Fixed size pool of worker threads. Tasks are run in the order they are
+// submitted, but may finish in any order
+class ThreadPool {
+public:
+    // 0 means one thread per hardware core
+    explicit ThreadPool(size_t numThreads = 0) {
+        if (!numThreads) {
+            numThreads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        for (size_t i = 0; i < numThreads; ++i) {
+            _threads.emplace_back([this] { work(); });
+        }
+    }
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    ~ThreadPool() {
+        {
+            auto lock = std::unique_lock{_mutex};
+            _isRunning = false;
+        }
+        _cv.notify_all();
+        for (auto &thread : _threads) {
+            thread.join();
+        }
+    }
+
+    size_t size() const {
+        return _threads.size();
+    }
+
+    template <typename F>
+    auto submit(F f) -> std::future<decltype(f())> {
+        using ResultT = decltype(f());
+        auto task = std::make_shared<std::packaged_task<ResultT()>>(
+            std::move(f));
+        auto future = task->get_future();
+        {
+            auto lock = std::unique_lock{_mutex};
+            _tasks.emplace([task] { (*task)(); });
+        }
+        _cv.notify_one();
+        return future;
+    }
+
+    // Call f(i) for every i in [0, num) and wait for all calls to finish.
+    // Indices are handed out in chunks so that each task does enough work to
+    // be worth the synchronization
+    template <typename F>
+    void parallelFor(size_t num, F f, size_t chunkSize = 0) {
+        if (!num) {
+            return;
+        }
+        if (!chunkSize) {
+            chunkSize = std::max<size_t>(1, num / (size() * 8));
+        }
+
+        auto futures = std::vector<std::future<void>>{};
+        futures.reserve(num / chunkSize + 1);
+        for (size_t begin = 0; begin < num; begin += chunkSize) {
+            auto end = std::min(num, begin + chunkSize);
+            futures.push_back(submit([&f, begin, end] {
+                for (auto i = begin; i < end; ++i) {
+                    f(i);
+                }
+            }));
+        }
+        // Wait for everything before rethrowing, the tasks reference f
+        for (auto &future : futures) {
+            future.wait();
+        }
+        for (auto &future : futures) {
+            future.get();
+        }
+    }
+
+private:
+    void work() {
+        for (;;) {
+            auto task = std::function<void()>{};
+            {
+                auto lock = std::unique_lock{_mutex};
+                _cv.wait(lock,
+                         [this] { return !_isRunning || !_tasks.empty(); });
+                if (_tasks.empty()) {
+                    return;
+                }
+                task = std::move(_tasks.front());
+                _tasks.pop();
+            }
+            task();
+        }
+    }
+
+    std::vector<std::thread> _threads;
+    std::queue<std::function<void()>> _tasks;
+    std::mutex _mutex;
+    std::condition_variable _cv;
+    bool _isRunning = true;
+};
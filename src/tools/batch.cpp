@@ -0,0 +1,320 @@
+// Compute gear profiles for a list of settings without opening any window
+//
+// Usage:
+//   involute-batch [options] [settings-file]
+//
+// Settings are read from stdin when no file is given, see readSettingsList()
+// for the format
+//
+// Options:
+//   -j <n>         number of worker threads (default: all cores)
+//   -o <file>      write profiles to file instead of stdout
+//   --summary      only print the number of points for each gear
+//   --tolerance <t> sample the flanks adaptively so that no chord deviates
+//                  more than t from the involute, instead of 20 even steps
+//   --cache <dir>  load profiles from and store new profiles in dir
+//   --verify       compare the vectorized kernel against the scalar profile
+//                  generator, and the arc generator against sin and cos, for
+//                  every gear instead of writing profiles. The compile time
+//                  tables of the standard gears are checked as well
+
+#include "arc.h"
+#include "profilecache.h"
+#include "profilegenerator.h"
+#include "profilekernel.h"
+#include "settingsio.h"
+#include "standardgears.h"
+#include "threadpool.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Arguments {
+    size_t numThreads = 0;
+    std::string input;
+    std::string output;
+    std::string cacheDirectory;
+    float tolerance = 0;
+    bool summary = false;
+    bool verify = false;
+};
+
+void printHelp() {
+    std::cerr << "usage: involute-batch [-j threads] [-o output] [--summary] "
+                 "[--tolerance t] [--cache dir] [--verify] [settings-file]\n";
+}
+
+std::optional<Arguments> parseArguments(int argc, char **argv) {
+    auto args = Arguments{};
+    for (int i = 1; i < argc; ++i) {
+        auto arg = std::string{argv[i]};
+        if (arg == "-j" && i + 1 < argc) {
+            try {
+                args.numThreads = std::stoul(argv[++i]);
+            }
+            catch (std::exception &) {
+                return std::nullopt;
+            }
+        }
+        else if (arg == "-o" && i + 1 < argc) {
+            args.output = argv[++i];
+        }
+        else if (arg == "--tolerance" && i + 1 < argc) {
+            try {
+                args.tolerance = std::stof(argv[++i]);
+            }
+            catch (std::exception &) {
+                return std::nullopt;
+            }
+            if (args.tolerance <= 0) {
+                return std::nullopt;
+            }
+        }
+        else if (arg == "--cache" && i + 1 < argc) {
+            args.cacheDirectory = argv[++i];
+        }
+        else if (arg == "--summary") {
+            args.summary = true;
+        }
+        else if (arg == "--verify") {
+            args.verify = true;
+        }
+        else if (arg == "-h" || arg == "--help" || arg.empty() ||
+                 arg[0] == '-') {
+            return std::nullopt;
+        }
+        else {
+            args.input = arg;
+        }
+    }
+    return args;
+}
+
+void writeProfile(std::FILE *out,
+                  const GearSettings &settings,
+                  const glm::vec2 *points,
+                  size_t size,
+                  bool summary) {
+    std::fprintf(out,
+                 "gear %d %d %g %zu\n",
+                 settings.numTeeth,
+                 settings.module,
+                 settings.preassureAngle,
+                 size);
+    if (summary) {
+        return;
+    }
+    for (size_t i = 0; i < size; ++i) {
+        std::fprintf(out, "%.6f %.6f\n", points[i].x, points[i].y);
+    }
+}
+
+// Relative to the size of the gear
+constexpr float kernelTolerance = 1e-5f;
+
+int verifyKernel(const std::vector<GearSettings> &settingsList,
+                 const std::vector<ProfileSampling> &samplings) {
+    int numFailed = 0;
+    for (size_t i = 0; i < settingsList.size(); ++i) {
+        auto &settings = settingsList.at(i);
+        auto error = verifyProfileKernel(settings, samplings.at(i));
+        auto r = settings.addendumD / 2;
+        auto arcError = arcDeviation(r);
+        auto isOk = error <= kernelTolerance * settings.addendumD &&
+                    arcError <= arcTolerance * r;
+        numFailed += !isOk;
+        std::printf("%s %d %d %g max error %g arc error %g\n",
+                    isOk ? "ok" : "FAILED",
+                    settings.numTeeth,
+                    settings.module,
+                    settings.preassureAngle,
+                    error,
+                    arcError);
+    }
+    std::printf("%s kernel: %d of %zu failed\n",
+                profileKernelInstructionSet(),
+                numFailed,
+                settingsList.size());
+    return numFailed ? 1 : 0;
+}
+
+// The baked standard gears against the half teeth computed at run time
+int verifyStandardGears() {
+    int numFailed = 0;
+    auto halfTooth = std::vector<glm::vec2>(halfToothSize());
+    for (auto &gear : standardGears) {
+        auto &settings = gear.settings;
+        forEachHalfToothPoint(settings, {}, [&](size_t i, glm::vec2 p) {
+            halfTooth[i] = p;
+        });
+        auto error = 0.f;
+        for (size_t i = 0; i < halfTooth.size(); ++i) {
+            error = std::max(error,
+                             glm::distance(halfTooth[i], gear.halfTooth[i]));
+        }
+        auto isOk = error <= kernelTolerance * settings.addendumD;
+        numFailed += !isOk;
+        std::printf("%s standard %d %d %g max error %g\n",
+                    isOk ? "ok" : "FAILED",
+                    settings.numTeeth,
+                    settings.module,
+                    settings.preassureAngle,
+                    error);
+    }
+    std::printf("standard gears: %d of %zu failed\n",
+                numFailed,
+                standardGears.size());
+    return numFailed ? 1 : 0;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    auto args = parseArguments(argc, argv);
+    if (!args) {
+        printHelp();
+        return 1;
+    }
+
+    auto settingsList = std::vector<GearSettings>{};
+    try {
+        if (args->input.empty()) {
+            settingsList = readSettingsList(std::cin);
+        }
+        else {
+            auto file = std::ifstream{args->input};
+            if (!file) {
+                std::cerr << "could not open " << args->input << "\n";
+                return 1;
+            }
+            settingsList = readSettingsList(file);
+        }
+    }
+    catch (std::exception &e) {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    auto pool = ThreadPool{args->numThreads};
+
+    auto samplings = std::vector<ProfileSampling>(settingsList.size());
+    auto deviations = std::vector<float>(settingsList.size());
+    pool.parallelFor(settingsList.size(), [&](size_t i) {
+        if (args->tolerance > 0) {
+            samplings[i] =
+                ProfileSampling::adaptive(settingsList[i], args->tolerance);
+            deviations[i] = samplings[i].maxDeviation;
+        }
+        else {
+            deviations[i] = flankDeviation(settingsList[i]);
+        }
+    });
+
+    if (args->verify) {
+        auto kernelResult = verifyKernel(settingsList, samplings);
+        return verifyStandardGears() || kernelResult;
+    }
+
+    // Where the points for each gear ends up
+    auto results = std::vector<std::pair<const glm::vec2 *, size_t>>(
+        settingsList.size());
+
+    auto points = std::vector<glm::vec2>{};
+    auto cached = std::vector<std::shared_ptr<const CachedProfile>>{};
+    auto cache = std::optional<ProfileCache>{};
+
+    if (args->cacheDirectory.empty()) {
+        // All profiles share one buffer that is allocated up front, so the
+        // workers never touch the allocator
+        auto offsets = std::vector<size_t>(settingsList.size() + 1);
+        for (size_t i = 0; i < settingsList.size(); ++i) {
+            offsets.at(i + 1) = offsets.at(i) + profileSize(settingsList.at(i),
+                                                            samplings.at(i));
+        }
+        points.resize(offsets.back());
+
+        pool.parallelFor(settingsList.size(), [&](size_t i) {
+            auto size = offsets[i + 1] - offsets[i];
+            generateProfile(settingsList[i],
+                            points.data() + offsets[i],
+                            size,
+                            samplings[i]);
+            results[i] = {points.data() + offsets[i], size};
+        });
+    }
+    else {
+        cache.emplace(args->cacheDirectory);
+        cached.resize(settingsList.size());
+        pool.parallelFor(settingsList.size(), [&](size_t i) {
+            cached[i] = cache->get(settingsList[i], samplings[i]);
+            results[i] = {cached[i]->data(), cached[i]->size()};
+        });
+    }
+
+    auto duration = std::chrono::steady_clock::now() - start;
+
+    auto out = stdout;
+    if (!args->output.empty()) {
+        out = std::fopen(args->output.c_str(), "w");
+        if (!out) {
+            std::cerr << "could not open " << args->output << "\n";
+            return 1;
+        }
+    }
+
+    for (size_t i = 0; i < settingsList.size(); ++i) {
+        writeProfile(out,
+                     settingsList.at(i),
+                     results.at(i).first,
+                     results.at(i).second,
+                     args->summary);
+    }
+
+    if (out != stdout) {
+        std::fclose(out);
+    }
+
+    std::cerr << "computed " << settingsList.size() << " profiles on "
+              << pool.size() << " threads in "
+              << std::chrono::duration<double, std::milli>(duration).count()
+              << " ms\n";
+
+    if (!deviations.empty()) {
+        std::cerr << "largest flank deviation "
+                  << *std::max_element(deviations.begin(), deviations.end())
+                  << "\n";
+    }
+    if (args->tolerance > 0) {
+        auto numMissed = std::count_if(
+            deviations.begin(), deviations.end(), [&](float deviation) {
+                return deviation > args->tolerance;
+            });
+        if (numMissed) {
+            std::cerr << "could not reach tolerance " << args->tolerance
+                      << " for " << numMissed << " gears\n";
+        }
+    }
+
+    if (cache) {
+        auto stats = cache->stats();
+        std::cerr << "cache: " << stats.memoryHits << " memory hits, "
+                  << stats.diskHits << " disk hits, " << stats.computed
+                  << " computed\n";
+        if (stats.writeFailures) {
+            std::cerr << "could not write " << stats.writeFailures
+                      << " profiles to " << args->cacheDirectory << "\n";
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,178 @@
+// Lay out gears on a plate and write them as SVG, DXF or G-code for laser
+// cutters and CNC machines
+//
+// Usage:
+//   involute-export [options] -o <file> [settings-file]
+//
+// Settings are read from stdin when no file is given, see readSettingsList()
+// for the format. The format is taken from the extension of the output file
+//
+// Options:
+//   -o <file>        output file (.svg, .dxf, .gcode, .nc or .ngc), "-" for
+//                    stdout together with --format
+//   --format <f>     svg, dxf or gcode
+//   --width <w>      width of the plate in mm (default 600)
+//   --spacing <s>    distance between gears and to the edges (default 2)
+//   --tolerance <t>  sample the flanks adaptively, see involute-batch
+//   --feed <f>       G-code feed rate in mm/min (default 1000)
+
+#include "bufferedwriter.h"
+#include "settingsio.h"
+#include "vectorexport.h"
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Arguments {
+    std::string input;
+    std::string output;
+    std::optional<ExportFormat> format;
+    float width = 600;
+    float spacing = 2;
+    float tolerance = 0;
+    float feedRate = 1000;
+};
+
+void printHelp() {
+    std::cerr << "usage: involute-export -o output [--format svg|dxf|gcode] "
+                 "[--width w] [--spacing s] [--tolerance t] [--feed f] "
+                 "[settings-file]\n";
+}
+
+std::optional<Arguments> parseArguments(int argc, char **argv) {
+    auto args = Arguments{};
+    try {
+        for (int i = 1; i < argc; ++i) {
+            auto arg = std::string{argv[i]};
+            if (arg == "-o" && i + 1 < argc) {
+                args.output = argv[++i];
+            }
+            else if (arg == "--format" && i + 1 < argc) {
+                auto format = ExportFormat{};
+                if (!exportFormatFromPath(std::string{"."} + argv[++i],
+                                          format)) {
+                    return std::nullopt;
+                }
+                args.format = format;
+            }
+            else if (arg == "--width" && i + 1 < argc) {
+                args.width = std::stof(argv[++i]);
+            }
+            else if (arg == "--spacing" && i + 1 < argc) {
+                args.spacing = std::stof(argv[++i]);
+            }
+            else if (arg == "--tolerance" && i + 1 < argc) {
+                args.tolerance = std::stof(argv[++i]);
+            }
+            else if (arg == "--feed" && i + 1 < argc) {
+                args.feedRate = std::stof(argv[++i]);
+            }
+            else if (arg.empty() || arg[0] == '-') {
+                return std::nullopt;
+            }
+            else {
+                args.input = arg;
+            }
+        }
+    }
+    catch (std::exception &) {
+        return std::nullopt;
+    }
+
+    if (args.output.empty() || args.width <= 0 || args.spacing < 0) {
+        return std::nullopt;
+    }
+
+    if (!args.format) {
+        auto format = ExportFormat{};
+        if (!exportFormatFromPath(args.output, format)) {
+            std::cerr << "unknown format for " << args.output << "\n";
+            return std::nullopt;
+        }
+        args.format = format;
+    }
+
+    return args;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    auto args = parseArguments(argc, argv);
+    if (!args) {
+        printHelp();
+        return 1;
+    }
+
+    auto settingsList = std::vector<GearSettings>{};
+    try {
+        if (args->input.empty()) {
+            settingsList = readSettingsList(std::cin);
+        }
+        else {
+            auto file = std::ifstream{args->input};
+            if (!file) {
+                std::cerr << "could not open " << args->input << "\n";
+                return 1;
+            }
+            settingsList = readSettingsList(file);
+        }
+    }
+    catch (std::exception &e) {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    auto layout = layoutPlate(settingsList, args->width, args->spacing);
+
+    auto file = stdout;
+    if (args->output != "-") {
+        file = std::fopen(args->output.c_str(), "wb");
+        if (!file) {
+            std::cerr << "could not open " << args->output << "\n";
+            return 1;
+        }
+    }
+
+    auto isGood = true;
+    auto maxDeviation = 0.f;
+    {
+        auto out = BufferedWriter{file};
+        auto options = ExportOptions{};
+        options.feedRate = args->feedRate;
+        auto exporter = makeVectorExporter(*args->format, out, options);
+        maxDeviation = exportPlate(*exporter, layout, args->tolerance);
+        out.flush();
+        isGood = out.good();
+    }
+
+    if (args->tolerance > 0 && maxDeviation > args->tolerance) {
+        std::cerr << "could not reach tolerance " << args->tolerance
+                  << ", the flanks deviate up to " << maxDeviation << "\n";
+    }
+
+    if (file != stdout) {
+        isGood = std::fclose(file) == 0 && isGood;
+    }
+
+    if (!isGood) {
+        std::cerr << "could not write " << args->output << "\n";
+        return 1;
+    }
+
+    auto duration = std::chrono::steady_clock::now() - start;
+    std::cerr << "exported " << layout.items.size() << " gears on a "
+              << layout.size.x << " x " << layout.size.y << " mm plate in "
+              << std::chrono::duration<double, std::milli>(duration).count()
+              << " ms\n";
+
+    return 0;
+}
@@ -0,0 +1,170 @@
+// Extrude a gear into a solid spur or helical gear for 3D printing
+//
+// Usage:
+//   involute-extrude [options] -o <file.stl> teeth [module [preassureAngle]]
+//
+// The result is written as binary STL in the unit of the module (mm)
+//
+// Options:
+//   -o <file>        output file, "-" for stdout
+//   --height <h>     length along the axis (default 10)
+//   --helix <deg>    helix angle, 0 for a spur gear (default 0). Negative
+//                    angles give a left hand helix
+//   --bore <d>       diameter of the hole through the middle (default none)
+//   --layers <n>     layers along the axis (default: one per degree of twist)
+//   --tolerance <t>  sample the flanks adaptively, see involute-batch
+//   -j <n>           number of worker threads (default: all cores)
+
+#include "bufferedwriter.h"
+#include "compactprofile.h"
+#include "gearextrusion.h"
+#include "threadpool.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Arguments {
+    std::string output;
+    ExtrusionOptions extrusion;
+    float tolerance = 0;
+    size_t numThreads = 0;
+    GearSettings settings;
+};
+
+void printHelp() {
+    std::cerr << "usage: involute-extrude -o output.stl [--height h] "
+                 "[--helix deg] [--bore d] [--layers n] [--tolerance t] "
+                 "[-j n] teeth [module [preassureAngle]]\n";
+}
+
+std::optional<Arguments> parseArguments(int argc, char **argv) {
+    auto args = Arguments{};
+    auto positional = std::vector<std::string>{};
+    try {
+        for (int i = 1; i < argc; ++i) {
+            auto arg = std::string{argv[i]};
+            if (arg == "-o" && i + 1 < argc) {
+                args.output = argv[++i];
+            }
+            else if (arg == "--height" && i + 1 < argc) {
+                args.extrusion.height = std::stof(argv[++i]);
+            }
+            else if (arg == "--helix" && i + 1 < argc) {
+                args.extrusion.helixAngle = std::stof(argv[++i]);
+            }
+            else if (arg == "--bore" && i + 1 < argc) {
+                args.extrusion.boreDiameter = std::stof(argv[++i]);
+            }
+            else if (arg == "--layers" && i + 1 < argc) {
+                args.extrusion.numLayers = std::stoi(argv[++i]);
+            }
+            else if (arg == "--tolerance" && i + 1 < argc) {
+                args.tolerance = std::stof(argv[++i]);
+            }
+            else if (arg == "-j" && i + 1 < argc) {
+                args.numThreads = std::stoul(argv[++i]);
+            }
+            else if (arg.empty() || arg[0] == '-') {
+                return std::nullopt;
+            }
+            else {
+                positional.push_back(arg);
+            }
+        }
+
+        if (positional.empty() || positional.size() > 3) {
+            return std::nullopt;
+        }
+        auto numTeeth = std::stoi(positional.at(0));
+        auto module = positional.size() > 1 ? std::stoi(positional.at(1)) : 1;
+        auto preassureAngle =
+            positional.size() > 2 ? std::stof(positional.at(2)) : 20.f;
+        args.settings = GearSettings{.numTeeth = numTeeth,
+                                     .module = module,
+                                     .preassureAngle = preassureAngle};
+    }
+    catch (std::exception &) {
+        return std::nullopt;
+    }
+
+    auto &extrusion = args.extrusion;
+    if (args.output.empty() || args.settings.numTeeth < 3 ||
+        args.settings.module < 1 || extrusion.height <= 0 ||
+        extrusion.boreDiameter < 0 || extrusion.numLayers < 0 ||
+        std::abs(extrusion.helixAngle) >= 80) {
+        return std::nullopt;
+    }
+
+    if (extrusion.boreDiameter >= args.settings.dedendumD) {
+        std::cerr << "the bore must be smaller than the dedendum diameter "
+                  << args.settings.dedendumD << "\n";
+        return std::nullopt;
+    }
+
+    return args;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    auto args = parseArguments(argc, argv);
+    if (!args) {
+        printHelp();
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    auto sampling =
+        args->tolerance > 0
+            ? ProfileSampling::adaptive(args->settings, args->tolerance)
+            : ProfileSampling{};
+    if (args->tolerance > 0 && sampling.maxDeviation > args->tolerance) {
+        std::cerr << "could not reach tolerance " << args->tolerance
+                  << ", the flanks deviate up to " << sampling.maxDeviation
+                  << "\n";
+    }
+    auto profile = CompactProfile{args->settings, sampling};
+
+    auto file = stdout;
+    if (args->output != "-") {
+        file = std::fopen(args->output.c_str(), "wb");
+        if (!file) {
+            std::cerr << "could not open " << args->output << "\n";
+            return 1;
+        }
+    }
+
+    auto pool = ThreadPool{args->numThreads};
+    auto isGood = true;
+    {
+        auto out = BufferedWriter{file};
+        writeExtrusionStl(profile, args->extrusion, out, &pool);
+        out.flush();
+        isGood = out.good();
+    }
+
+    if (file != stdout) {
+        isGood = std::fclose(file) == 0 && isGood;
+    }
+
+    if (!isGood) {
+        std::cerr << "could not write " << args->output << "\n";
+        return 1;
+    }
+
+    auto resolved = resolveExtrusion(args->settings, args->extrusion);
+    auto duration = std::chrono::steady_clock::now() - start;
+    std::cerr << "wrote " << extrusionTriangleCount(profile, args->extrusion)
+              << " triangles in " << resolved.numLayers << " layers in "
+              << std::chrono::duration<double, std::milli>(duration).count()
+              << " ms\n";
+
+    return 0;
+}
@@ -0,0 +1,250 @@
+// Cut a gear with a simulated rack or pinion cutter and write its outline
+// as SVG, DXF or G-code
+//
+// Usage:
+//   involute-generate [options] -o <file> teeth [module [preassureAngle]]
+//   involute-generate --verify [options] [teeth [module [preassureAngle]]]
+//
+// Unlike the other tools the profile is not calculated from the involute,
+// but from where the cutter goes, see generateEnvelope(). That also gives
+// profile shifted gears, rounded roots and the undercut of small gears
+//
+// Options:
+//   -o <file>          output file (.svg, .dxf, .gcode, .nc or .ngc), "-"
+//                      for stdout together with --format
+//   --format <f>       svg, dxf or gcode
+//   --shift <x>        profile shift coefficient (default 0)
+//   --tip-radius <r>   rounding of the rack tips, in modules (default 0)
+//   --cutter <n>       cut with a pinion cutter with n teeth instead of a rack
+//   --positions <n>    cutter positions per pitch (default 360)
+//   --rays <n>         points per tooth (default 1024)
+//   -j <n>             number of worker threads (default: all cores)
+//   --verify           check the cut against a brute force point in cutter
+//                      test instead of writing a file, for the given gear or
+//                      for 8 to 16 teeth
+
+#include "bufferedwriter.h"
+#include "envelope.h"
+#include "threadpool.h"
+#include "vectorexport.h"
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Space around the gear, in mm
+constexpr float margin = 2;
+
+// Relative to the module
+constexpr float verifyTolerance = 1e-3f;
+
+struct Arguments {
+    std::string output;
+    std::optional<ExportFormat> format;
+    EnvelopeOptions envelope;
+    size_t numThreads = 0;
+    bool verify = false;
+    // Empty with --verify and no gear
+    std::vector<GearSettings> settingsList;
+};
+
+void printHelp() {
+    std::cerr << "usage: involute-generate -o output [--format svg|dxf|gcode] "
+                 "[--shift x] [--tip-radius r] [--cutter n] [--positions n] "
+                 "[--rays n] [-j n] teeth [module [preassureAngle]]\n"
+                 "       involute-generate --verify [options] "
+                 "[teeth [module [preassureAngle]]]\n";
+}
+
+std::optional<Arguments> parseArguments(int argc, char **argv) {
+    auto args = Arguments{};
+    auto &envelope = args.envelope;
+    auto positional = std::vector<std::string>{};
+    try {
+        for (int i = 1; i < argc; ++i) {
+            auto arg = std::string{argv[i]};
+            if (arg == "-o" && i + 1 < argc) {
+                args.output = argv[++i];
+            }
+            else if (arg == "--format" && i + 1 < argc) {
+                auto format = ExportFormat{};
+                if (!exportFormatFromPath(std::string{"."} + argv[++i],
+                                          format)) {
+                    return std::nullopt;
+                }
+                args.format = format;
+            }
+            else if (arg == "--shift" && i + 1 < argc) {
+                envelope.profileShift = std::stof(argv[++i]);
+            }
+            else if (arg == "--tip-radius" && i + 1 < argc) {
+                envelope.rack.tipRadius = std::stof(argv[++i]);
+            }
+            else if (arg == "--cutter" && i + 1 < argc) {
+                envelope.cutterTeeth = std::stoi(argv[++i]);
+            }
+            else if (arg == "--positions" && i + 1 < argc) {
+                envelope.numPositions = std::stoi(argv[++i]);
+            }
+            else if (arg == "--rays" && i + 1 < argc) {
+                envelope.numRays = std::stoi(argv[++i]);
+            }
+            else if (arg == "-j" && i + 1 < argc) {
+                args.numThreads = std::stoul(argv[++i]);
+            }
+            else if (arg == "--verify") {
+                args.verify = true;
+            }
+            else if (arg.empty() || arg[0] == '-') {
+                return std::nullopt;
+            }
+            else {
+                positional.push_back(arg);
+            }
+        }
+
+        if ((positional.empty() && !args.verify) || positional.size() > 3) {
+            return std::nullopt;
+        }
+        if (positional.empty()) {
+            for (int numTeeth = 8; numTeeth <= 16; ++numTeeth) {
+                args.settingsList.push_back(GearSettings{numTeeth});
+            }
+        }
+        else {
+            auto numTeeth = std::stoi(positional.at(0));
+            auto module =
+                positional.size() > 1 ? std::stoi(positional.at(1)) : 1;
+            auto preassureAngle =
+                positional.size() > 2 ? std::stof(positional.at(2)) : 20.f;
+            args.settingsList.push_back(
+                GearSettings{.numTeeth = numTeeth,
+                             .module = module,
+                             .preassureAngle = preassureAngle});
+        }
+    }
+    catch (std::exception &) {
+        return std::nullopt;
+    }
+
+    if ((args.output.empty() && !args.verify) || envelope.rack.tipRadius < 0 ||
+        (envelope.cutterTeeth != 0 && envelope.cutterTeeth < 3) ||
+        envelope.numPositions < 1 || envelope.numRays < 4) {
+        return std::nullopt;
+    }
+
+    for (auto &settings : args.settingsList) {
+        if (settings.numTeeth < 3 || settings.module < 1) {
+            return std::nullopt;
+        }
+        // The cutter must not reach the center
+        auto reference =
+            settings.pitchD / 2.f + envelope.profileShift * settings.module;
+        if (reference - envelope.rack.dedendum * settings.module <= 0) {
+            std::cerr << "the profile shift is too small for the cutter\n";
+            return std::nullopt;
+        }
+    }
+
+    if (args.verify) {
+        return args;
+    }
+
+    if (!args.format) {
+        auto format = ExportFormat{};
+        if (!exportFormatFromPath(args.output, format)) {
+            std::cerr << "unknown format for " << args.output << "\n";
+            return std::nullopt;
+        }
+        args.format = format;
+    }
+
+    return args;
+}
+
+// Cut every gear and compare it with verifyEnvelope()
+int verify(const Arguments &args, ThreadPool &pool) {
+    int numFailed = 0;
+    for (auto &settings : args.settingsList) {
+        auto profile = generateEnvelope(settings, args.envelope, &pool);
+        auto error = verifyEnvelope(profile, &pool);
+        auto isOk = error <= verifyTolerance * settings.module;
+        numFailed += !isOk;
+        std::printf("%s %d %d %g max error %g\n",
+                    isOk ? "ok" : "FAILED",
+                    settings.numTeeth,
+                    settings.module,
+                    settings.preassureAngle,
+                    error);
+    }
+    std::printf("envelope: %d of %zu failed\n",
+                numFailed,
+                args.settingsList.size());
+    return numFailed ? 1 : 0;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    auto args = parseArguments(argc, argv);
+    if (!args) {
+        printHelp();
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    auto pool = ThreadPool{args->numThreads};
+    if (args->verify) {
+        return verify(*args, pool);
+    }
+
+    auto &settings = args->settingsList.front();
+    auto profile = generateEnvelope(settings, args->envelope, &pool);
+    auto points = profile.points();
+
+    auto size = profile.tipRadius() * 2 + margin * 2;
+
+    auto file = stdout;
+    if (args->output != "-") {
+        file = std::fopen(args->output.c_str(), "wb");
+        if (!file) {
+            std::cerr << "could not open " << args->output << "\n";
+            return 1;
+        }
+    }
+
+    auto isGood = true;
+    {
+        auto out = BufferedWriter{file};
+        auto exporter = makeVectorExporter(*args->format, out);
+        exporter->begin({size, size});
+        exportLoop(*exporter, points, {size / 2, size / 2});
+        exporter->end();
+        out.flush();
+        isGood = out.good();
+    }
+
+    if (file != stdout) {
+        isGood = std::fclose(file) == 0 && isGood;
+    }
+
+    if (!isGood) {
+        std::cerr << "could not write " << args->output << "\n";
+        return 1;
+    }
+
+    auto duration = std::chrono::steady_clock::now() - start;
+    std::cerr << "cut " << settings.numTeeth << " teeth with "
+              << args->envelope.numPositions << " positions per pitch on "
+              << pool.size() << " threads in "
+              << std::chrono::duration<double, std::milli>(duration).count()
+              << " ms, root diameter " << profile.rootRadius() * 2
+              << ", tip diameter " << profile.tipRadius() * 2 << "\n";
+
+    return 0;
+}
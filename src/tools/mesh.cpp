@@ -0,0 +1,226 @@
+// Check a pair of meshing gears for interference
+//
+// Usage:
+//   involute-mesh [options] teeth1 teeth2 [module] [preassureAngle]
+//
+// Gear 1 is rotated through one pitch with gear 2 following, and the
+// clearance between the profiles is checked at every step
+//
+// Options:
+//   --center-distance <d>  distance between the gear centers (default is the
+//                          standard distance, the sum of the pitch radii)
+//   --steps <n>            number of angles to check (default 720)
+//   --tolerance <t>        sample the flanks adaptively, see involute-batch
+//   -j <n>                 number of worker threads (default: all cores)
+//   --csv <file>           analyze the mesh instead: write transmission
+//                          error, backlash and the number of teeth in
+//                          contact for every step as csv ("-" for stdout),
+//                          and print the contact ratio
+//   --field                look up the clearance in distance fields of the
+//                          profiles instead of between the segments, see
+//                          sweepMeshField()
+
+#include "distancefield.h"
+#include "interference.h"
+#include "meshanalysis.h"
+#include "settingsio.h"
+#include "threadpool.h"
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Arguments {
+    int numTeeth1 = 0;
+    int numTeeth2 = 0;
+    int module = 1;
+    float preassureAngle = 20;
+    float centerDistance = 0;
+    int numSteps = 720;
+    float tolerance = 0;
+    size_t numThreads = 0;
+    std::string csvPath;
+    bool useField = false;
+};
+
+std::optional<Arguments> parseArguments(int argc, char **argv) {
+    auto args = Arguments{};
+    auto positional = std::vector<std::string>{};
+    try {
+        for (int i = 1; i < argc; ++i) {
+            auto arg = std::string{argv[i]};
+            if (arg == "--center-distance" && i + 1 < argc) {
+                args.centerDistance = std::stof(argv[++i]);
+            }
+            else if (arg == "--steps" && i + 1 < argc) {
+                args.numSteps = std::stoi(argv[++i]);
+            }
+            else if (arg == "--tolerance" && i + 1 < argc) {
+                args.tolerance = std::stof(argv[++i]);
+            }
+            else if (arg == "-j" && i + 1 < argc) {
+                args.numThreads = std::stoul(argv[++i]);
+            }
+            else if (arg == "--csv" && i + 1 < argc) {
+                args.csvPath = argv[++i];
+            }
+            else if (arg == "--field") {
+                args.useField = true;
+            }
+            else if (arg.empty() || arg[0] == '-') {
+                return std::nullopt;
+            }
+            else {
+                positional.push_back(arg);
+            }
+        }
+
+        if (positional.size() < 2 || positional.size() > 4) {
+            return std::nullopt;
+        }
+        args.numTeeth1 = std::stoi(positional.at(0));
+        args.numTeeth2 = std::stoi(positional.at(1));
+        if (positional.size() > 2) {
+            args.module = std::stoi(positional.at(2));
+        }
+        if (positional.size() > 3) {
+            args.preassureAngle = std::stof(positional.at(3));
+        }
+    }
+    catch (std::exception &) {
+        return std::nullopt;
+    }
+
+    if (args.numTeeth1 < 3 || args.numTeeth2 < 3 || args.module < 1 ||
+        args.numSteps < 1) {
+        return std::nullopt;
+    }
+
+    return args;
+}
+
+int analyze(const Arguments &args,
+            const GearSettings &a,
+            const GearSettings &b,
+            float centerDistance,
+            ProfileSampling sampling,
+            ThreadPool &pool) {
+    auto file = std::ofstream{};
+    if (args.csvPath != "-") {
+        file.open(args.csvPath);
+        if (!file) {
+            std::cerr << "could not open " << args.csvPath << "\n";
+            return 1;
+        }
+    }
+    auto &out = args.csvPath == "-" ? std::cout : file;
+
+    auto start = std::chrono::steady_clock::now();
+    auto analysis =
+        analyzeMesh(a, b, centerDistance, args.numSteps, pool, sampling);
+    auto duration = std::chrono::steady_clock::now() - start;
+
+    writeMeshCsv(analysis, out);
+
+    // The csv can go to stdout, so the summary goes to stderr
+    std::cerr << "center distance " << centerDistance << "\n"
+              << "contact ratio " << analysis.contactRatio << " (measured "
+              << analysis.meanContacts << ")\n"
+              << "transmission error " << analysis.transmissionErrorPeakToPeak
+              << " peak to peak\n"
+              << "backlash " << analysis.minBacklash << " to "
+              << analysis.maxBacklash << "\n";
+    if (analysis.numCollisions) {
+        std::cerr << "collisions at " << analysis.numCollisions << " of "
+                  << args.numSteps << " steps\n";
+    }
+    std::cerr << "analyzed " << args.numSteps << " angles on " << pool.size()
+              << " threads in "
+              << std::chrono::duration<double, std::milli>(duration).count()
+              << " ms\n";
+
+    return analysis.numCollisions ? 2 : 0;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    auto args = parseArguments(argc, argv);
+    if (!args) {
+        std::cerr << "usage: involute-mesh [--center-distance d] [--steps n] "
+                     "[--tolerance t] [-j threads] [--csv file] [--field] "
+                     "teeth1 teeth2 [module] [preassureAngle]\n";
+        return 1;
+    }
+
+    auto a =
+        makeGearSettings(args->numTeeth1, args->module, args->preassureAngle);
+    auto b =
+        makeGearSettings(args->numTeeth2, args->module, args->preassureAngle);
+
+    auto centerDistance = args->centerDistance > 0
+                              ? args->centerDistance
+                              : (a.pitchD + b.pitchD) / 2.f;
+
+    auto sampling = ProfileSampling{};
+    if (args->tolerance > 0) {
+        sampling = ProfileSampling::adaptive(
+            a.numTeeth > b.numTeeth ? a : b, args->tolerance);
+        if (sampling.maxDeviation > args->tolerance) {
+            std::cerr << "could not reach tolerance " << args->tolerance
+                      << ", the flanks deviate up to "
+                      << sampling.maxDeviation << "\n";
+        }
+    }
+
+    auto pool = ThreadPool{args->numThreads};
+
+    if (!args->csvPath.empty()) {
+        return analyze(*args, a, b, centerDistance, sampling, pool);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    auto sweep =
+        args->useField
+            ? sweepMeshField(
+                  a, b, centerDistance, args->numSteps, pool, sampling)
+            : sweepMesh(a, b, centerDistance, args->numSteps, pool, sampling);
+    auto duration = std::chrono::steady_clock::now() - start;
+
+    std::printf("center distance %g\n", centerDistance);
+    std::printf("min clearance %g at angle %g\n",
+                sweep.minClearance,
+                sweep.minClearanceAngle);
+
+    if (sweep.collisionAngles.empty()) {
+        std::printf("no collisions\n");
+    }
+    else {
+        // Print consecutive colliding steps as ranges
+        auto step = a.pitchAngle / args->numSteps;
+        auto &angles = sweep.collisionAngles;
+        auto begin = angles.front();
+        for (size_t i = 1; i <= angles.size(); ++i) {
+            if (i == angles.size() || angles[i] - angles[i - 1] > step * 1.5f) {
+                std::printf("collision from angle %g to %g\n",
+                            begin,
+                            angles[i - 1]);
+                if (i < angles.size()) {
+                    begin = angles[i];
+                }
+            }
+        }
+    }
+
+    std::cerr << "checked " << args->numSteps << " angles on " << pool.size()
+              << " threads in "
+              << std::chrono::duration<double, std::milli>(duration).count()
+              << " ms\n";
+
+    return sweep.collisionAngles.empty() ? 0 : 2;
+}
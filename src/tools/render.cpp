@@ -0,0 +1,342 @@
+// Render an animation of a meshing gear pair without any display
+//
+// Usage:
+//   involute-render [options] -o <file> [teeth1 teeth2 [module]
+//                   [preassureAngle]]
+//
+// The driving gear turns one pitch over the animation, so it loops without
+// a jump. The default is the same pair of 30 teeth gears as in the viewer
+//
+// Options:
+//   -o <file>        .gif for an animated GIF, .png for a numbered PNG
+//                    sequence (frames/gear.png gives frames/gear0000.png ...)
+//   --size <w>x<h>   image size in pixels (default 800x600)
+//   --frames <n>     number of frames (default 60)
+//   --fps <n>        frames per second for GIF (default 30)
+//   --no-circles     only draw the gears, not the reference circles
+//   -j <n>           number of worker threads (default: all cores)
+
+#include "bufferedwriter.h"
+#include "compactprofile.h"
+#include "drawlist.h"
+#include "geartrain.h"
+#include "imageencoder.h"
+#include "rasterizer.h"
+#include "settingsio.h"
+#include "threadpool.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Arguments {
+    std::string output;
+    int width = 800;
+    int height = 600;
+    int numFrames = 60;
+    int fps = 30;
+    bool drawCircles = true;
+    size_t numThreads = 0;
+    int numTeeth1 = 30;
+    int numTeeth2 = 30;
+    int module = 1;
+    float preassureAngle = 20;
+};
+
+bool endsWith(const std::string &str, const std::string &end) {
+    return str.size() >= end.size() &&
+           str.compare(str.size() - end.size(), end.size(), end) == 0;
+}
+
+std::optional<Arguments> parseArguments(int argc, char **argv) {
+    auto args = Arguments{};
+    auto positional = std::vector<std::string>{};
+    try {
+        for (int i = 1; i < argc; ++i) {
+            auto arg = std::string{argv[i]};
+            if (arg == "-o" && i + 1 < argc) {
+                args.output = argv[++i];
+            }
+            else if (arg == "--size" && i + 1 < argc) {
+                auto size = std::string{argv[++i]};
+                auto x = size.find('x');
+                if (x == std::string::npos) {
+                    return std::nullopt;
+                }
+                args.width = std::stoi(size.substr(0, x));
+                args.height = std::stoi(size.substr(x + 1));
+            }
+            else if (arg == "--frames" && i + 1 < argc) {
+                args.numFrames = std::stoi(argv[++i]);
+            }
+            else if (arg == "--fps" && i + 1 < argc) {
+                args.fps = std::stoi(argv[++i]);
+            }
+            else if (arg == "--no-circles") {
+                args.drawCircles = false;
+            }
+            else if (arg == "-j" && i + 1 < argc) {
+                args.numThreads = std::stoul(argv[++i]);
+            }
+            else if (arg.empty() || arg[0] == '-') {
+                return std::nullopt;
+            }
+            else {
+                positional.push_back(arg);
+            }
+        }
+
+        if (positional.size() == 1 || positional.size() > 4) {
+            return std::nullopt;
+        }
+        if (positional.size() >= 2) {
+            args.numTeeth1 = std::stoi(positional.at(0));
+            args.numTeeth2 = std::stoi(positional.at(1));
+        }
+        if (positional.size() > 2) {
+            args.module = std::stoi(positional.at(2));
+        }
+        if (positional.size() > 3) {
+            args.preassureAngle = std::stof(positional.at(3));
+        }
+    }
+    catch (std::exception &) {
+        return std::nullopt;
+    }
+
+    if (!endsWith(args.output, ".gif") && !endsWith(args.output, ".png")) {
+        return std::nullopt;
+    }
+
+    if (args.width < 1 || args.height < 1 || args.width > 16384 ||
+        args.height > 16384 || args.numFrames < 1 || args.fps < 1 ||
+        args.numTeeth1 < 3 || args.numTeeth2 < 3 || args.module < 1) {
+        return std::nullopt;
+    }
+
+    return args;
+}
+
+// frames/gear.png -> frames/gear0012.png
+std::string framePath(const std::string &path, int frame) {
+    char number[16];
+    std::snprintf(number, sizeof(number), "%04d", frame);
+    return path.substr(0, path.size() - 4) + number + ".png";
+}
+
+bool writeFile(const std::string &path, const std::vector<uint8_t> &data) {
+    auto file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        return false;
+    }
+    auto isGood = std::fwrite(data.data(), 1, data.size(), file) == data.size();
+    return std::fclose(file) == 0 && isGood;
+}
+
+// Same layout and colors as the viewer
+struct Animation {
+    CompactProfile gear1;
+    CompactProfile gear2;
+    ReferenceCircles circles1;
+    ReferenceCircles circles2;
+    GearTrain train;
+    float scale = 1;
+    bool drawCircles = true;
+
+    Animation(const Arguments &args)
+        : gear1{makeGearSettings(
+              args.numTeeth1, args.module, args.preassureAngle)}
+        , gear2{makeGearSettings(
+              args.numTeeth2, args.module, args.preassureAngle)}
+        , circles1{gear1.settings}
+        , circles2{gear2.settings}
+        , drawCircles{args.drawCircles} {
+        auto &a = gear1.settings;
+        auto &b = gear2.settings;
+
+        // Fit both gears with a margin
+        auto r1 = a.addendumD / 2;
+        auto r2 = b.addendumD / 2;
+        auto centerDistance = (a.pitchD + b.pitchD) / 2;
+        auto width = r1 + centerDistance + r2;
+        auto height = std::max(r1, r2) * 2;
+        auto margin = 10.f;
+        scale = std::min((args.width - 2 * margin) / width,
+                         (args.height - 2 * margin) / height);
+
+        auto pos1 = glm::vec2{(args.width / scale - width) / 2 + r1,
+                              args.height / scale / 2};
+        train.add(a, pos1);
+        train.add(b, pos1 + glm::vec2{centerDistance, 0});
+        train.connect();
+        train.solve(0);
+    }
+
+    // Buffers for one frame, one set for each frame rendered in parallel
+    struct Frame {
+        RasterScene scene;
+        Image image;
+        std::vector<float> angles;
+        std::vector<glm::vec2> buffer;
+        std::vector<uint8_t> encoded;
+    };
+
+    void draw(float driverAngle, Frame &frame) const {
+        train.update(driverAngle, frame.angles);
+        auto pos1 = train.gears().at(0).pos;
+        auto pos2 = train.gears().at(1).pos;
+        auto angle1 = frame.angles.at(0);
+        auto &scene = frame.scene;
+        auto &buffer = frame.buffer;
+
+        auto circle = [&](const std::vector<glm::vec2> &points,
+                          glm::vec2 pos,
+                          Color color) {
+            transformPoints(points, pos, scale, buffer);
+            scene.drawLines(buffer, color);
+        };
+
+        scene.clear({100, 0, 0});
+
+        if (drawCircles) {
+            auto gray = Color{100, 100, 100};
+            auto r = gear1.settings.pitchD / 2;
+            for (auto angle :
+                 {angle1, angle1 + gear1.settings.pitchAngle}) {
+                auto end = pos1 + r * glm::vec2{std::cos(angle),
+                                                std::sin(angle)};
+                scene.drawLine(pos1 * scale, end * scale, gray);
+            }
+
+            circle(circles1.addendum, pos1, gray);
+            circle(circles1.clearing, pos1, gray);
+            circle(circles2.pitch, pos2, gray);
+            circle(circles1.dedendum, pos1, {0, 0, 30});
+            circle(circles1.base, pos1, {200, 0, 0});
+            circle(circles1.pitch, pos1, {200, 200, 200});
+        }
+
+        transformLoop(gear1, pos1, angle1, scale, buffer);
+        scene.drawLines(buffer, {200, 200, 200});
+        transformLoop(gear2, pos2, frame.angles.at(1), scale, buffer);
+        scene.drawLines(buffer, {200, 200, 200});
+    }
+};
+
+} // namespace
+
+int main(int argc, char **argv) {
+    auto args = parseArguments(argc, argv);
+    if (!args) {
+        std::cerr << "usage: involute-render -o output.gif|output.png "
+                     "[--size wxh] [--frames n] [--fps n] [--no-circles] "
+                     "[-j threads] [teeth1 teeth2 [module] "
+                     "[preassureAngle]]\n";
+        return 1;
+    }
+
+    auto isGif = endsWith(args->output, ".gif");
+    auto gifFile = static_cast<std::FILE *>(nullptr);
+    if (isGif) {
+        gifFile = std::fopen(args->output.c_str(), "wb");
+        if (!gifFile) {
+            std::cerr << "could not open " << args->output << "\n";
+            return 1;
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    auto pool = ThreadPool{args->numThreads};
+    auto animation = Animation{*args};
+    auto pitchAngle = animation.gear1.settings.pitchAngle;
+    auto delay = std::max(1, 100 / args->fps);
+
+    // Whole frames are rendered in parallel, in batches so that the memory
+    // does not grow with the number of frames. Each batch is written in order
+    // before the next one starts
+    auto frames = std::vector<Animation::Frame>(pool.size() * 2);
+    for (auto &frame : frames) {
+        frame.image = Image{args->width, args->height};
+    }
+
+    auto isGood = true;
+    {
+        auto out = std::optional<BufferedWriter>{};
+        if (isGif) {
+            out.emplace(gifFile);
+            auto header = gifHeader(args->width, args->height);
+            out->write(header.data(), header.size());
+        }
+
+        for (int first = 0; first < args->numFrames && isGood;
+             first += static_cast<int>(frames.size())) {
+            auto count = std::min<size_t>(frames.size(),
+                                          args->numFrames - first);
+            auto render = [&](size_t i, ThreadPool *tilePool) {
+                auto &frame = frames[i];
+                auto index = first + static_cast<int>(i);
+                animation.draw(pitchAngle * index / args->numFrames, frame);
+                rasterize(frame.scene, frame.image, tilePool);
+                frame.encoded = isGif ? gifFrame(frame.image, delay)
+                                      : encodePng(frame.image);
+            };
+
+            if (count < pool.size()) {
+                // Too few frames to keep all threads busy, split the frames
+                // into tiles instead
+                for (size_t i = 0; i < count; ++i) {
+                    render(i, &pool);
+                }
+            }
+            else {
+                pool.parallelFor(
+                    count, [&](size_t i) { render(i, nullptr); }, 1);
+            }
+
+            for (size_t i = 0; i < count; ++i) {
+                if (isGif) {
+                    out->write(frames[i].encoded.data(),
+                               frames[i].encoded.size());
+                }
+                else if (!writeFile(framePath(args->output,
+                                              first + static_cast<int>(i)),
+                                    frames[i].encoded)) {
+                    std::cerr << "could not write frame " << first + i
+                              << "\n";
+                    isGood = false;
+                    break;
+                }
+            }
+        }
+
+        if (out) {
+            *out << static_cast<char>(gifTrailer);
+            out->flush();
+            isGood = isGood && out->good();
+        }
+    }
+
+    if (gifFile) {
+        isGood = std::fclose(gifFile) == 0 && isGood;
+    }
+
+    if (!isGood) {
+        std::cerr << "could not write " << args->output << "\n";
+        return 1;
+    }
+
+    auto duration = std::chrono::steady_clock::now() - start;
+    std::cerr << "rendered " << args->numFrames << " frames of "
+              << args->width << "x" << args->height << " on " << pool.size()
+              << " threads in "
+              << std::chrono::duration<double, std::milli>(duration).count()
+              << " ms\n";
+
+    return 0;
+}
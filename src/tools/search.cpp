@@ -0,0 +1,176 @@
+// Search for gear pairs with a given ratio and center distance
+//
+// Usage:
+//   involute-search [options] ratio
+//
+// ratio is the teeth of the driven gear divided by the teeth of the driving
+// gear. The best pairs are printed, one per line, see searchPairs() for how
+// they are picked and ranked
+//
+// Options:
+//   --ratio-tolerance <t>    allowed ratio error, relative (default 0.01)
+//   --center-distance <d>    run the pairs at this distance (default: the
+//                            standard distance of each pair)
+//   --center-tolerance <t>   how far from --center-distance the standard
+//                            distance of a pair may be (default 0.5)
+//   --teeth <min> <max>      teeth of each gear (default 8 200)
+//   --module <min> <max>     (default 1 10)
+//   --angles <a,b,...>       preassure angles to try (default 14.5,20,25)
+//   --min-contact-ratio <c>  (default 1.2)
+//   --steps <n>              angles checked for collisions (default 64)
+//   --tolerance <t>          sample the flanks adaptively, see involute-batch
+//   -n <n>                   number of pairs to print (default 20)
+//   -j <n>                   number of worker threads (default: all cores)
+
+#include "pairsearch.h"
+#include "threadpool.h"
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <optional>
+#include <sstream>
+#include <string>
+
+namespace {
+
+struct Arguments {
+    PairSearch search;
+    float tolerance = 0;
+    size_t numThreads = 0;
+};
+
+std::vector<float> parseAngles(const std::string &text) {
+    auto angles = std::vector<float>{};
+    auto stream = std::istringstream{text};
+    for (std::string item; std::getline(stream, item, ',');) {
+        angles.push_back(std::stof(item));
+    }
+    return angles;
+}
+
+std::optional<Arguments> parseArguments(int argc, char **argv) {
+    auto args = Arguments{};
+    auto &search = args.search;
+    auto positional = std::vector<std::string>{};
+    try {
+        for (int i = 1; i < argc; ++i) {
+            auto arg = std::string{argv[i]};
+            if (arg == "--ratio-tolerance" && i + 1 < argc) {
+                search.ratioTolerance = std::stof(argv[++i]);
+            }
+            else if (arg == "--center-distance" && i + 1 < argc) {
+                search.centerDistance = std::stof(argv[++i]);
+            }
+            else if (arg == "--center-tolerance" && i + 1 < argc) {
+                search.centerTolerance = std::stof(argv[++i]);
+            }
+            else if (arg == "--teeth" && i + 2 < argc) {
+                search.minTeeth = std::stoi(argv[++i]);
+                search.maxTeeth = std::stoi(argv[++i]);
+            }
+            else if (arg == "--module" && i + 2 < argc) {
+                search.minModule = std::stoi(argv[++i]);
+                search.maxModule = std::stoi(argv[++i]);
+            }
+            else if (arg == "--angles" && i + 1 < argc) {
+                search.preassureAngles = parseAngles(argv[++i]);
+            }
+            else if (arg == "--min-contact-ratio" && i + 1 < argc) {
+                search.minContactRatio = std::stof(argv[++i]);
+            }
+            else if (arg == "--steps" && i + 1 < argc) {
+                search.numSteps = std::stoi(argv[++i]);
+            }
+            else if (arg == "--tolerance" && i + 1 < argc) {
+                args.tolerance = std::stof(argv[++i]);
+            }
+            else if (arg == "-n" && i + 1 < argc) {
+                search.maxResults = std::stoul(argv[++i]);
+            }
+            else if (arg == "-j" && i + 1 < argc) {
+                args.numThreads = std::stoul(argv[++i]);
+            }
+            else if (arg.empty() || arg[0] == '-') {
+                return std::nullopt;
+            }
+            else {
+                positional.push_back(arg);
+            }
+        }
+
+        if (positional.size() != 1) {
+            return std::nullopt;
+        }
+        search.ratio = std::stof(positional.front());
+    }
+    catch (std::exception &) {
+        return std::nullopt;
+    }
+
+    if (search.ratio <= 0 || search.ratioTolerance < 0 ||
+        search.centerTolerance < 0 || search.minTeeth < 3 ||
+        search.minTeeth > search.maxTeeth || search.minModule < 1 ||
+        search.minModule > search.maxModule ||
+        search.preassureAngles.empty() || search.numSteps < 1) {
+        return std::nullopt;
+    }
+
+    return args;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    auto args = parseArguments(argc, argv);
+    if (!args) {
+        std::cerr << "usage: involute-search [--ratio-tolerance t] "
+                     "[--center-distance d] [--center-tolerance t] "
+                     "[--teeth min max] [--module min max] [--angles a,b] "
+                     "[--min-contact-ratio c] [--steps n] [--tolerance t] "
+                     "[-n results] [-j threads] ratio\n";
+        return 1;
+    }
+
+    auto &search = args->search;
+    if (args->tolerance > 0) {
+        // The largest gear has the most curved flanks relative to the
+        // tolerance, so its sampling is used for all of them
+        search.sampling = ProfileSampling::adaptive(
+            GearSettings{.numTeeth = search.maxTeeth,
+                         .module = search.maxModule},
+            args->tolerance);
+        if (search.sampling.maxDeviation > args->tolerance) {
+            std::cerr << "could not reach tolerance " << args->tolerance
+                      << ", the flanks deviate up to "
+                      << search.sampling.maxDeviation << "\n";
+        }
+    }
+
+    auto pool = ThreadPool{args->numThreads};
+
+    auto start = std::chrono::steady_clock::now();
+    auto result = searchPairs(search, pool);
+    auto duration = std::chrono::steady_clock::now() - start;
+
+    std::printf("teeth1 teeth2 module angle center ratio contact clearance\n");
+    for (auto &candidate : result.candidates) {
+        std::printf("%d %d %d %g %g %g %.3f %.4f\n",
+                    candidate.a.numTeeth,
+                    candidate.b.numTeeth,
+                    candidate.a.module,
+                    candidate.a.preassureAngle,
+                    candidate.centerDistance,
+                    candidate.ratio,
+                    candidate.contactRatio,
+                    candidate.minClearance);
+    }
+
+    std::cerr << "enumerated " << result.numEnumerated << " pairs, pruned "
+              << result.numPruned << ", swept " << result.numSwept << " ("
+              << result.numColliding << " colliding) on " << pool.size()
+              << " threads in "
+              << std::chrono::duration<double, std::milli>(duration).count()
+              << " ms\n";
+
+    return result.candidates.empty() ? 2 : 0;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Lock free handoff of values from one writer thread to one reader thread
+//
+// The writer fills back() and calls publish(). The reader calls update() to
+// get the most recently published value in front(). Neither side ever waits
+// for the other, values published in between reads are skipped
+template <typename T>
+class TripleBuffer {
+public:
+    TripleBuffer() = default;
+
+    explicit TripleBuffer(const T &init)
+        : _buffers{init, init, init} {}
+
+    // Writer side
+    T &back() {
+        return _buffers[_back];
+    }
+
+    void publish() {
+        auto old =
+            _middle.exchange(_back | dirtyBit, std::memory_order_acq_rel);
+        _back = old & indexMask;
+    }
+
+    // Reader side. Returns true if a new value was published since last call
+    bool update() {
+        if (!(_middle.load(std::memory_order_relaxed) & dirtyBit)) {
+            return false;
+        }
+        auto old = _middle.exchange(_front, std::memory_order_acq_rel);
+        _front = old & indexMask;
+        return true;
+    }
+
+    const T &front() const {
+        return _buffers[_front];
+    }
+
+private:
+    static constexpr uint8_t dirtyBit = 4;
+    static constexpr uint8_t indexMask = 3;
+
+    T _buffers[3] = {};
+    uint8_t _front = 0;
+    std::atomic<uint8_t> _middle{1};
+    uint8_t _back = 2;
+};
@@ -0,0 +1,223 @@
+#include "vectorexport.h"
+#include "compactprofile.h"
+#include <algorithm>
+#include <cctype>
+
+namespace {
+
+std::string extension(const std::string &path) {
+    auto dot = path.rfind('.');
+    if (dot == std::string::npos) {
+        return {};
+    }
+    auto ext = path.substr(dot + 1);
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) {
+        return static_cast<char>(std::tolower(c));
+    });
+    return ext;
+}
+
+// SVG has y pointing down, so the plate is flipped to keep gears facing
+// the same way as in the other formats
+class SvgExporter : public VectorExporter {
+public:
+    SvgExporter(BufferedWriter &out)
+        : _out{out} {}
+
+    void begin(glm::vec2 size) override {
+        _height = size.y;
+        _out << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+             << "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"" << size.x
+             << "mm\" height=\"" << size.y << "mm\" viewBox=\"0 0 " << size.x
+             << ' ' << size.y << "\">\n"
+             << "<g fill=\"none\" stroke=\"black\" stroke-width=\"0.1\">\n";
+    }
+
+    void moveTo(glm::vec2 p) override {
+        _out << "<path d=\"M" << p.x << ',' << _height - p.y << 'L';
+        _isFirstLine = true;
+    }
+
+    void lineTo(glm::vec2 p) override {
+        if (!_isFirstLine) {
+            _out << ' ';
+        }
+        _isFirstLine = false;
+        _out << p.x << ',' << _height - p.y;
+    }
+
+    void closePath() override {
+        _out << "Z\"/>\n";
+    }
+
+    void end() override {
+        _out << "</g>\n</svg>\n";
+    }
+
+private:
+    BufferedWriter &_out;
+    float _height = 0;
+    bool _isFirstLine = true;
+};
+
+// AutoCAD R12 entities, which every CAD and laser program reads. Old style
+// POLYLINE entities are used since they do not need the number of vertices
+// up front
+class DxfExporter : public VectorExporter {
+public:
+    DxfExporter(BufferedWriter &out)
+        : _out{out} {}
+
+    void begin(glm::vec2) override {
+        // $INSUNITS 4 is millimeters
+        _out << "0\nSECTION\n2\nHEADER\n9\n$INSUNITS\n70\n4\n0\nENDSEC\n"
+             << "0\nSECTION\n2\nENTITIES\n";
+    }
+
+    void moveTo(glm::vec2 p) override {
+        // 66 says that vertices follow, 70 = 1 closes the polyline
+        _out << "0\nPOLYLINE\n8\n0\n66\n1\n10\n0\n20\n0\n30\n0\n70\n1\n";
+        lineTo(p);
+    }
+
+    void lineTo(glm::vec2 p) override {
+        _out << "0\nVERTEX\n8\n0\n10\n" << p.x << "\n20\n" << p.y
+             << "\n30\n0\n";
+    }
+
+    void closePath() override {
+        _out << "0\nSEQEND\n8\n0\n";
+    }
+
+    void end() override {
+        _out << "0\nENDSEC\n0\nEOF\n";
+    }
+
+private:
+    BufferedWriter &_out;
+};
+
+// Absolute moves in millimeters. Rapid to the start of every path, turn the
+// tool on, cut around the path and turn the tool off again
+class GcodeExporter : public VectorExporter {
+public:
+    GcodeExporter(BufferedWriter &out, ExportOptions options)
+        : _out{out}
+        , _options{std::move(options)} {}
+
+    void begin(glm::vec2 size) override {
+        _out << "; involute gears " << size.x << " x " << size.y << " mm\n"
+             << "G21\nG90\n" << _options.toolOff.c_str() << '\n';
+    }
+
+    void moveTo(glm::vec2 p) override {
+        _start = p;
+        _out << "G0 X" << p.x << " Y" << p.y << '\n'
+             << _options.toolOn.c_str() << '\n'
+             << "G1 F" << _options.feedRate << '\n';
+    }
+
+    void lineTo(glm::vec2 p) override {
+        _out << "G1 X" << p.x << " Y" << p.y << '\n';
+    }
+
+    void closePath() override {
+        lineTo(_start);
+        _out << _options.toolOff.c_str() << '\n';
+    }
+
+    void end() override {
+        _out << "M2\n";
+    }
+
+private:
+    BufferedWriter &_out;
+    ExportOptions _options;
+    glm::vec2 _start = {};
+};
+
+} // namespace
+
+bool exportFormatFromPath(const std::string &path, ExportFormat &format) {
+    auto ext = extension(path);
+    if (ext == "svg") {
+        format = ExportFormat::Svg;
+    }
+    else if (ext == "dxf") {
+        format = ExportFormat::Dxf;
+    }
+    else if (ext == "gcode" || ext == "nc" || ext == "ngc") {
+        format = ExportFormat::Gcode;
+    }
+    else {
+        return false;
+    }
+    return true;
+}
+
+std::unique_ptr<VectorExporter> makeVectorExporter(ExportFormat format,
+                                                   BufferedWriter &out,
+                                                   ExportOptions options) {
+    switch (format) {
+    case ExportFormat::Svg:
+        return std::make_unique<SvgExporter>(out);
+    case ExportFormat::Dxf:
+        return std::make_unique<DxfExporter>(out);
+    case ExportFormat::Gcode:
+        return std::make_unique<GcodeExporter>(out, std::move(options));
+    }
+    return nullptr;
+}
+
+PlateLayout layoutPlate(const std::vector<GearSettings> &settingsList,
+                        float width,
+                        float spacing) {
+    auto layout = PlateLayout{};
+    layout.items.reserve(settingsList.size());
+
+    auto x = spacing;
+    auto y = spacing;
+    auto rowHeight = 0.f;
+    for (auto &settings : settingsList) {
+        auto d = settings.addendumD;
+        if (x > spacing && x + d + spacing > width) {
+            // Start a new row
+            x = spacing;
+            y += rowHeight + spacing;
+            rowHeight = 0;
+        }
+        layout.items.push_back({settings, {x + d / 2, y + d / 2}});
+        x += d + spacing;
+        rowHeight = std::max(rowHeight, d);
+        layout.size.x = std::max(layout.size.x, x);
+    }
+
+    if (!layout.items.empty()) {
+        layout.size.y = y + rowHeight + spacing;
+    }
+
+    return layout;
+}
+
+float exportPlate(VectorExporter &exporter,
+                 const PlateLayout &layout,
+                 float tolerance) {
+    exporter.begin(layout.size);
+
+    // The same profile is reused for every gear, so its buffers only grow
+    // to the size of the largest gear
+    auto profile = CompactProfile{GearSettings{}};
+    auto maxDeviation = 0.f;
+    for (auto &item : layout.items) {
+        profile.settings = item.settings;
+        profile.sampling = tolerance > 0 ? ProfileSampling::adaptive(
+                                               item.settings, tolerance)
+                                         : ProfileSampling{};
+        maxDeviation = std::max(maxDeviation, profile.sampling.maxDeviation);
+        profile.computeProfile();
+        exportLoop(exporter, profile, item.pos);
+    }
+
+    exporter.end();
+    return maxDeviation;
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include "bufferedwriter.h"
+#include "gearsettings.h"
+#include "profilegenerator.h"
+#include <cmath>
+#include <glm/glm.hpp>
+#include <memory>
+#include <string>
+#include <vector>
+
+enum class ExportFormat {
+    Svg,
+    Dxf,
+    Gcode,
+};
+
+// Format from the file extension (.svg, .dxf, .gcode, .nc or .ngc). Returns
+// false if the extension is not known
+bool exportFormatFromPath(const std::string &path, ExportFormat &format);
+
+struct ExportOptions {
+    // G-code only: feed rate in mm/min for cutting moves, and the commands
+    // that turn the laser or spindle on and off around every path
+    float feedRate = 1000;
+    std::string toolOn = "M3";
+    std::string toolOff = "M5";
+};
+
+// Writes closed paths to a vector file as they are given, nothing is kept in
+// memory apart from the buffer of the writer
+class VectorExporter {
+public:
+    virtual ~VectorExporter() = default;
+
+    // size is the extent of everything that is written, starting at (0, 0),
+    // in millimeters
+    virtual void begin(glm::vec2 size) = 0;
+    virtual void moveTo(glm::vec2 p) = 0;
+    virtual void lineTo(glm::vec2 p) = 0;
+    virtual void closePath() = 0;
+    virtual void end() = 0;
+};
+
+std::unique_ptr<VectorExporter> makeVectorExporter(ExportFormat format,
+                                                   BufferedWriter &out,
+                                                   ExportOptions options = {});
+
+// Write a closed loop of points, like GearProfile::points or a
+// CompactProfile, rotated by angle and moved to pos
+template <typename Points>
+void exportLoop(VectorExporter &exporter,
+                const Points &points,
+                glm::vec2 pos,
+                float angle = 0) {
+    auto c = std::cos(angle);
+    auto s = std::sin(angle);
+    auto first = glm::vec2{};
+    auto last = glm::vec2{};
+    size_t count = 0;
+    for (glm::vec2 p : points) {
+        // Each point is written when the next one is seen, so that the
+        // point closing the loop can be left out
+        if (count > 1) {
+            exporter.lineTo(last);
+        }
+        last = glm::vec2{c * p.x - s * p.y, s * p.x + c * p.y} + pos;
+        if (count++ == 0) {
+            first = last;
+            exporter.moveTo(first);
+        }
+    }
+    if (count == 0) {
+        return;
+    }
+    if (count > 1 && last != first) {
+        exporter.lineTo(last);
+    }
+    exporter.closePath();
+}
+
+// Gears placed in rows on a plate, in the order they are given
+struct PlateLayout {
+    struct Item {
+        GearSettings settings;
+        // Center of the gear
+        glm::vec2 pos;
+    };
+
+    std::vector<Item> items;
+
+    // Extent of all gears including the margin
+    glm::vec2 size = {};
+};
+
+// Place the gears left to right in rows no wider than width, with spacing
+// between the addendum circles and around the plate. Gears wider than the
+// plate get a row of their own
+PlateLayout layoutPlate(const std::vector<GearSettings> &settingsList,
+                        float width,
+                        float spacing);
+
+// Generate and write the gears of the layout one at a time, so that the
+// memory used does not depend on the number of gears. Returns the largest
+// flank deviation of the adaptive sampling, which is above tolerance if it
+// could not be reached
+float exportPlate(VectorExporter &exporter,
+                 const PlateLayout &layout,
+                 float tolerance = 0);